@@ -0,0 +1,51 @@
+#!/bin/sh
+# choose hot functions from measured cycle counts
+# usage: hot-list.sh <profile> <sizes> <budget>
+#
+# profile - lines of "<function> <cycles>", e.g. cycles per period
+# sizes   - "nm -S" output of the firmware or a host build
+# budget  - hot text bytes, e.g. REEF_HOT_TEXT_SIZE
+#
+# Functions with the most cycles per byte are chosen until the budget is
+# used. Mark the printed functions with __hot_text.
+
+if [ $# -ne 3 ]; then
+	echo "usage: $0 <profile> <sizes> <budget>" >&2
+	exit 1
+fi
+
+budget=$(($3))
+
+awk '
+function hex(s,    i, n) {
+	n = 0
+	s = tolower(s)
+	for (i = 1; i <= length(s); i++)
+		n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+	return n
+}
+
+# sizes first, functions only
+FNR == NR {
+	if (NF == 4 && ($3 == "t" || $3 == "T"))
+		size[$4] = hex($2)
+	next
+}
+
+# profile
+$1 in size && size[$1] > 0 {
+	printf "%.6f %s %d\n", $2 / size[$1], $1, size[$1]
+	next
+}
+
+{
+	print "no size for " $1 > "/dev/stderr"
+}' $2 $1 | sort -rn | awk -v budget=$budget '
+$3 + total <= budget {
+	total += $3
+	print $2
+}
+
+END {
+	print "# " total + 0 " of " budget " bytes" > "/dev/stderr"
+}'
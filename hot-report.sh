@@ -0,0 +1,32 @@
+#!/bin/sh
+# report hot code and data placement of linked firmware
+# usage: hot-report.sh <nm> <elf>
+
+NM=$1
+ELF=$2
+
+# symbol value in hex
+sym() {
+	$NM $ELF | awk -v s=$1 '$3 == s { print $1 }'
+}
+
+# bytes between two symbols
+span() {
+	echo $((0x`sym $2` - 0x`sym $1`))
+}
+
+text=`span _hot_text_start _hot_text_end`
+data=$((`span _hot_data_start _hot_data_end` + `span _hot_bss_start _hot_bss_end`))
+
+echo "hot text: $text of $((0x`sym _hot_text_size`)) bytes"
+echo "hot data: $data of $((0x`sym _hot_data_size`)) bytes"
+
+# hot symbols, nm prints fixed width hex so strings compare as numbers
+$NM -S --size-sort $ELF | awk \
+	-v ts=`sym _hot_text_start` -v te=`sym _hot_text_end` \
+	-v ds=`sym _hot_data_start` -v de=`sym _hot_data_end` \
+	-v bs=`sym _hot_bss_start` -v be=`sym _hot_bss_end` '
+	NF == 4 && (($1 >= ts && $1 < te) || ($1 >= ds && $1 < de) ||
+		($1 >= bs && $1 < be)) {
+		print "  " $4 " 0x" $2
+	}'
@@ -33,14 +33,23 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <xtensa/config/core.h>
 #include <xtensa/hal.h>
 
+#define DCACHE_LINE_SIZE	XCHAL_DCACHE_LINESIZE
+
 #if defined CONFIG_BAYTRAIL || defined CONFIG_CHERRYTRAIL
 
 static inline void dcache_writeback_region(void *addr, size_t size) {}
 static inline void dcache_invalidate_region(void *addr, size_t size) {}
 static inline void icache_invalidate_region(void *addr, size_t size) {}
 static inline void dcache_writeback_invalidate_region(void *addr, size_t size) {}
+
+/* data cache is not used */
+static inline int dcache_is_cached(void *addr)
+{
+	return 0;
+}
 #else
 
 static inline void dcache_writeback_region(void *addr, size_t size)
@@ -63,6 +72,16 @@ static inline void dcache_writeback_invalidate_region(void *addr, size_t size)
 	xthal_dcache_region_writeback_inv(addr, size);
 }
 
+/* is addr cached - cache attributes are 4 bits per 512MB region */
+static inline int dcache_is_cached(void *addr)
+{
+	uint32_t attr;
+
+	attr = (xthal_get_cacheattr() >> (((uint32_t)addr >> 29) * 4)) & 0xf;
+
+	return attr != XCHAL_CA_BYPASS && attr != XCHAL_CA_BYPASSBUF;
+}
+
 #endif
 #endif
 
@@ -36,105 +36,51 @@
 #include <stdint.h>
 #include <errno.h>
 
-static struct task *_irq_low_task = NULL;
-static struct task *_irq_med_task = NULL;
-static struct task *_irq_high_task = NULL;
+/* task dispatched at each priority level */
+static struct task *_irq_task[TASK_LEVELS];
 
-static inline uint32_t task_get_irq(struct task *task)
-{
-	uint32_t irq;
-
-	switch (task->priority) {
-	case TASK_PRI_MED + 1 ... TASK_PRI_LOW:
-		irq = PLATFORM_IRQ_TASK_LOW;
-		break;
-	case TASK_PRI_HIGH ... TASK_PRI_MED - 1:
-		irq = PLATFORM_IRQ_TASK_HIGH;
-		break;
-	case TASK_PRI_MED:
-	default:
-		irq = PLATFORM_IRQ_TASK_MED;
-		break;
-	}
-
-	return irq;
-}
-
-static inline void task_set_data(struct task *task)
-{
-	switch (task->priority) {
-	case TASK_PRI_MED + 1 ... TASK_PRI_LOW:
-		_irq_low_task = task;
-		break;
-	case TASK_PRI_HIGH ... TASK_PRI_MED - 1:
-		_irq_high_task = task;
-		break;
-	case TASK_PRI_MED:
-	default:
-		_irq_med_task = task;
-		break;
-	}
-}
+/* IRQ for each priority level - higher levels preempt lower levels */
+static const uint32_t _irq_level[TASK_LEVELS] = {
+	[TASK_LEVEL_LOW] = PLATFORM_IRQ_TASK_LOW,
+	[TASK_LEVEL_MED] = PLATFORM_IRQ_TASK_MED,
+	[TASK_LEVEL_HIGH] = PLATFORM_IRQ_TASK_HIGH,
+};
 
-static void _irq_low(void *arg)
+static inline uint32_t task_get_irq(struct task *task)
 {
-	struct task *task = *(struct task **)arg;
-	uint32_t irq;
-
-	if (task->func)
-		task->func(task->data);
-
-	schedule_task_complete(task);
-	irq = task_get_irq(task);
-	interrupt_clear(irq);
+	return _irq_level[task_get_level(task)];
 }
 
-static void _irq_med(void *arg)
+static void _irq_task_run(void *arg)
 {
 	struct task *task = *(struct task **)arg;
-	uint32_t irq;
-
-	if (task->func)
-		task->func(task->data);
-
-	schedule_task_complete(task);
-	irq = task_get_irq(task);
-	interrupt_clear(irq);
-}
 
-static void _irq_high(void *arg)
-{
-	struct task *task = *(struct task **)arg;
-	uint32_t irq;
+	schedule_task_running(task);
 
 	if (task->func)
 		task->func(task->data);
 
+	/* clear before completion as completion can dispatch the next task */
+	interrupt_clear(task_get_irq(task));
 	schedule_task_complete(task);
-	irq = task_get_irq(task);
-	interrupt_clear(irq);
 }
 
 /* architecture specific method of running task */
 void arch_run_task(struct task *task)
 {
-	uint32_t irq;
-
-	task_set_data(task);
-	irq = task_get_irq(task);
-	interrupt_set(irq);
+	_irq_task[task_get_level(task)] = task;
+	interrupt_set(task_get_irq(task));
 }
 
 int arch_init_tasks(void)
 {
-	interrupt_register(PLATFORM_IRQ_TASK_LOW, _irq_low, &_irq_low_task);
-	interrupt_enable(PLATFORM_IRQ_TASK_LOW);
-
-	interrupt_register(PLATFORM_IRQ_TASK_MED, _irq_med, &_irq_med_task);
-	interrupt_enable(PLATFORM_IRQ_TASK_MED);
+	int level;
 
-	interrupt_register(PLATFORM_IRQ_TASK_HIGH, _irq_high, &_irq_high_task);
-	interrupt_enable(PLATFORM_IRQ_TASK_HIGH);
+	for (level = 0; level < TASK_LEVELS; level++) {
+		interrupt_register(_irq_level[level], _irq_task_run,
+			&_irq_task[level]);
+		interrupt_enable(_irq_level[level]);
+	}
 
 	return 0;
 }
@@ -45,6 +45,13 @@
 #include <reef/audio/pipeline.h>
 #include <reef/audio/buffer.h>
 
+/* reset buffer health statistics */
+static void buffer_stats_reset(struct comp_buffer *buffer)
+{
+	bzero(&buffer->stats, sizeof(buffer->stats));
+	buffer->stats.low_water = buffer->ipc_buffer.size;
+}
+
 /* create a new component in the pipeline */
 struct comp_buffer *buffer_new(struct sof_ipc_buffer *desc)
 {
@@ -66,17 +73,16 @@ struct comp_buffer *buffer_new(struct sof_ipc_buffer *desc)
 		return NULL;
 	}
 
+	/* memory can also be found later when the pipeline is complete */
 	buffer->addr = rballoc(RZONE_RUNTIME, RFLAGS_NONE, desc->size);
-	if (buffer->addr == NULL) {
-		rfree(buffer);
-		trace_buffer_error("ebm");
-		return NULL;
-	}
+	if (buffer->addr == NULL)
+		trace_buffer("bmD");
+	else
+		bzero(buffer->addr, desc->size);
 
-	bzero(buffer->addr, desc->size);
 	memcpy(&buffer->ipc_buffer, desc, sizeof(*desc));
 
-	//buffer->size =
+	buffer->size = desc->size;
 	buffer->alloc_size = desc->size;
 	buffer->ipc_buffer = *desc;
 	buffer->w_ptr = buffer->r_ptr = buffer->addr;
@@ -84,6 +90,9 @@ struct comp_buffer *buffer_new(struct sof_ipc_buffer *desc)
 	buffer->free = buffer->ipc_buffer.size;
 	buffer->avail = 0;
 	buffer->connected = 0;
+	list_init(&buffer->pipe_list);
+	list_init(&buffer->fifo_list);
+	buffer_stats_reset(buffer);
 
 	return buffer;
 }
@@ -95,6 +104,136 @@ void buffer_free(struct comp_buffer *buffer)
 
 	list_item_del(&buffer->source_list);
 	list_item_del(&buffer->sink_list);
-	rfree(buffer->addr);
+	list_item_del(&buffer->pipe_list);
+	list_item_del(&buffer->fifo_list);
+
+	/* scratch pool memory is shared with other buffers */
+	if (buffer->scratch_addr)
+		pipeline_scratch_put(buffer);
+
+	/* aliased buffers dont own their memory */
+	if (buffer->alias_of)
+		buffer->alias_of->alias = NULL;
+	else if (buffer->addr && buffer->scratch_addr == NULL)
+		rbfree(buffer->addr);
+
+	/* our alias loses its memory too */
+	if (buffer->alias) {
+		buffer->alias->alias_of = NULL;
+		buffer->alias->addr = NULL;
+	}
+
 	rfree(buffer);
 }
+
+/* reset ring to empty at start of buffer memory */
+static void buffer_ring_reset(struct comp_buffer *buffer)
+{
+	buffer->w_ptr = buffer->r_ptr = buffer->addr;
+	buffer->end_addr = buffer->addr + buffer->ipc_buffer.size;
+	buffer->free = buffer->ipc_buffer.size;
+	buffer->avail = 0;
+}
+
+/* sink buffer releases its memory and shares the source buffer memory */
+void buffer_alias(struct comp_buffer *source, struct comp_buffer *sink)
+{
+	trace_buffer("BAl");
+
+	if (sink->scratch_addr == NULL)
+		rbfree(sink->addr);
+	sink->addr = source->addr;
+	source->alias = sink;
+	sink->alias_of = source;
+
+	buffer_ring_reset(source);
+	buffer_ring_reset(sink);
+}
+
+/* sink buffer gets its own memory again */
+int buffer_unalias(struct comp_buffer *sink)
+{
+	struct comp_buffer *source = sink->alias_of;
+	void *addr;
+
+	trace_buffer("BUa");
+
+	/* scratch buffers go back to their place in the pool */
+	if (sink->scratch_addr) {
+		addr = sink->scratch_addr;
+	} else {
+		addr = rballoc(RZONE_RUNTIME, RFLAGS_NONE, sink->alloc_size);
+		if (addr == NULL) {
+			trace_buffer_error("eUa");
+			return -ENOMEM;
+		}
+	}
+
+	bzero(addr, sink->alloc_size);
+	sink->addr = addr;
+	source->alias = NULL;
+	sink->alias_of = NULL;
+
+	buffer_ring_reset(source);
+	buffer_ring_reset(sink);
+	return 0;
+}
+
+/* buffer gets its own memory if it has none */
+int buffer_alloc(struct comp_buffer *buffer)
+{
+	if (buffer->addr)
+		return 0;
+
+	buffer->addr = rballoc(RZONE_RUNTIME, RFLAGS_NONE, buffer->alloc_size);
+	if (buffer->addr == NULL) {
+		trace_buffer_error("eBa");
+		return -ENOMEM;
+	}
+
+	bzero(buffer->addr, buffer->alloc_size);
+	buffer_ring_reset(buffer);
+	return 0;
+}
+
+/* buffer memory is placed at addr in the scratch pool */
+void buffer_scratch_set(struct comp_buffer *buffer, void *addr)
+{
+	/* own memory is no longer needed */
+	if (buffer->scratch_addr == NULL && buffer->alias_of == NULL &&
+		buffer->addr)
+		rbfree(buffer->addr);
+
+	buffer->scratch_addr = addr;
+
+	/* aliased buffers keep using their source buffer memory */
+	if (buffer->alias_of == NULL) {
+		buffer->addr = addr;
+		buffer_ring_reset(buffer);
+	}
+
+	if (buffer->alias) {
+		buffer->alias->addr = addr;
+		buffer_ring_reset(buffer->alias);
+	}
+}
+
+/* called by reader on underrun or writer on overrun */
+void comp_buffer_xrun(struct comp_buffer *buffer, int type)
+{
+	if (type == BUFFER_XRUN_UNDERRUN)
+		buffer->stats.underruns++;
+	else
+		buffer->stats.overruns++;
+
+	buffer->stats.last_xrun = platform_timer_get(NULL);
+
+	tracev_event2(TRACE_CLASS_BUFFER, "xrn",
+		buffer->ipc_buffer.comp.id, type);
+
+	/* host is notified from IPC context */
+	if (!buffer->stats.xrun_pending) {
+		buffer->stats.xrun_pending = 1;
+		ipc_buffer_xrun();
+	}
+}
@@ -78,8 +78,7 @@ struct comp_dev *comp_new(struct sof_ipc_comp *comp)
 	/* find the driver for our new component */
 	drv = get_drv(comp->type);
 	if (drv == NULL) {
-		trace_comp_error("eCD");
-		trace_value(comp->type);
+		trace_error1(TRACE_CLASS_COMP, "eCD", comp->type);
 		return NULL;
 	}
 
@@ -94,6 +93,8 @@ struct comp_dev *comp_new(struct sof_ipc_comp *comp)
 	memcpy(&cdev->comp, comp, sizeof(*comp));
 	cdev->drv = drv;
 	cdev->state = COMP_STATE_INIT;
+	cdev->fuse_head = NULL;
+	cdev->fuse_tail = NULL;
 	spinlock_init(&cdev->lock);
 	list_init(&cdev->bsource_list);
 	list_init(&cdev->bsink_list);
@@ -0,0 +1,525 @@
+/*
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Intel Corporation nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: agent <agent@local>
+ *
+ * Format and channel converter. Samples are unpacked from the source format
+ * to Q1.31, remixed to the sink channel count and packed to the sink format
+ * with rounding and saturation. Each stage is a plain loop over a span of
+ * samples so the compiler can vectorise it.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <reef/reef.h>
+#include <reef/lock.h>
+#include <reef/list.h>
+#include <reef/stream.h>
+#include <reef/alloc.h>
+#include <reef/audio/component.h>
+#include <reef/audio/pipeline.h>
+
+#define trace_convert(__e)	trace_event(TRACE_CLASS_CONVERT, __e)
+#define tracev_convert(__e)	tracev_event(TRACE_CLASS_CONVERT, __e)
+#define trace_convert_error(__e)	trace_error(TRACE_CLASS_CONVERT, __e)
+
+/* frames converted per span and max channels */
+#define CONVERT_SPAN		16
+#define CONVERT_MAX_CHANNELS	8
+
+#define CONVERT_FORMATS \
+	(COMP_FMT(SOF_IPC_FRAME_S16_LE) | COMP_FMT(SOF_IPC_FRAME_S24_4LE) | \
+	COMP_FMT(SOF_IPC_FRAME_S24_3LE) | COMP_FMT(SOF_IPC_FRAME_S32_LE))
+
+/* converter component private data */
+struct comp_data {
+	uint32_t source_channels;
+	uint32_t sink_channels;
+
+	void (*unpack)(const void *src, int32_t *dest, uint32_t samples);
+	void (*remix)(struct comp_data *cd, uint32_t frames);
+	void (*pack)(const int32_t *src, void *dest, uint32_t samples);
+
+	/* Q1.31 span before and after remix */
+	int32_t in[CONVERT_SPAN * CONVERT_MAX_CHANNELS];
+	int32_t out[CONVERT_SPAN * CONVERT_MAX_CHANNELS];
+};
+
+static inline int32_t sat_int16(int64_t x)
+{
+	if (x > INT16_MAX)
+		return INT16_MAX;
+	if (x < INT16_MIN)
+		return INT16_MIN;
+	return x;
+}
+
+static inline int32_t sat_int24(int64_t x)
+{
+	if (x > 0x7fffff)
+		return 0x7fffff;
+	if (x < -0x800000)
+		return -0x800000;
+	return x;
+}
+
+/*
+ * Unpack source samples to Q1.31.
+ */
+
+static void unpack_s16(const void *src, int32_t *dest, uint32_t samples)
+{
+	const int16_t *s = src;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++)
+		dest[i] = (int32_t)s[i] << 16;
+}
+
+static void unpack_s24_4le(const void *src, int32_t *dest, uint32_t samples)
+{
+	const uint32_t *s = src;
+	uint32_t i;
+
+	/* upper byte of container is ignored */
+	for (i = 0; i < samples; i++)
+		dest[i] = (int32_t)(s[i] << 8);
+}
+
+static void unpack_s24_3le(const void *src, int32_t *dest, uint32_t samples)
+{
+	const uint8_t *s = src;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++)
+		dest[i] = (int32_t)(((uint32_t)s[3 * i] << 8) |
+			((uint32_t)s[3 * i + 1] << 16) |
+			((uint32_t)s[3 * i + 2] << 24));
+}
+
+static void unpack_s32(const void *src, int32_t *dest, uint32_t samples)
+{
+	const int32_t *s = src;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++)
+		dest[i] = s[i];
+}
+
+/*
+ * Pack Q1.31 to sink samples - round to nearest and saturate.
+ */
+
+static void pack_s16(const int32_t *src, void *dest, uint32_t samples)
+{
+	int16_t *d = dest;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++)
+		d[i] = sat_int16(((int64_t)src[i] + (1 << 15)) >> 16);
+}
+
+static void pack_s24_4le(const int32_t *src, void *dest, uint32_t samples)
+{
+	int32_t *d = dest;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++)
+		d[i] = sat_int24(((int64_t)src[i] + (1 << 7)) >> 8);
+}
+
+static void pack_s24_3le(const int32_t *src, void *dest, uint32_t samples)
+{
+	uint8_t *d = dest;
+	int32_t x;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++) {
+		x = sat_int24(((int64_t)src[i] + (1 << 7)) >> 8);
+		d[3 * i] = x & 0xff;
+		d[3 * i + 1] = (x >> 8) & 0xff;
+		d[3 * i + 2] = (x >> 16) & 0xff;
+	}
+}
+
+static void pack_s32(const int32_t *src, void *dest, uint32_t samples)
+{
+	int32_t *d = dest;
+	uint32_t i;
+
+	for (i = 0; i < samples; i++)
+		d[i] = src[i];
+}
+
+/*
+ * Remix source channels to sink channels.
+ */
+
+/* same channels - no remix, pack straight from the unpacked span */
+static void remix_none(struct comp_data *cd, uint32_t frames)
+{
+}
+
+/* mono source duplicated to every sink channel */
+static void remix_dup(struct comp_data *cd, uint32_t frames)
+{
+	uint32_t nch = cd->sink_channels;
+	uint32_t i, ch;
+
+	for (ch = 0; ch < nch; ch++) {
+		for (i = 0; i < frames; i++)
+			cd->out[i * nch + ch] = cd->in[i];
+	}
+}
+
+/* all source channels averaged to mono sink */
+static void remix_avg(struct comp_data *cd, uint32_t frames)
+{
+	uint32_t nch = cd->source_channels;
+	uint32_t i, ch;
+	int64_t sum;
+
+	for (i = 0; i < frames; i++) {
+		sum = 0;
+		for (ch = 0; ch < nch; ch++)
+			sum += cd->in[i * nch + ch];
+		cd->out[i] = sum / nch;
+	}
+}
+
+/* common channels copied, extra sink channels zeroed */
+static void remix_map(struct comp_data *cd, uint32_t frames)
+{
+	uint32_t in_ch = cd->source_channels;
+	uint32_t out_ch = cd->sink_channels;
+	uint32_t i, ch;
+
+	for (ch = 0; ch < out_ch; ch++) {
+		if (ch < in_ch) {
+			for (i = 0; i < frames; i++)
+				cd->out[i * out_ch + ch] = cd->in[i * in_ch + ch];
+		} else {
+			for (i = 0; i < frames; i++)
+				cd->out[i * out_ch + ch] = 0;
+		}
+	}
+}
+
+/* map of frame format to unpack and pack function */
+struct convert_func_map {
+	enum sof_ipc_frame fmt;
+	void (*unpack)(const void *src, int32_t *dest, uint32_t samples);
+	void (*pack)(const int32_t *src, void *dest, uint32_t samples);
+};
+
+static const struct convert_func_map func_map[] = {
+	{SOF_IPC_FRAME_S16_LE, unpack_s16, pack_s16},
+	{SOF_IPC_FRAME_S24_4LE, unpack_s24_4le, pack_s24_4le},
+	{SOF_IPC_FRAME_S24_3LE, unpack_s24_3le, pack_s24_3le},
+	{SOF_IPC_FRAME_S32_LE, unpack_s32, pack_s32},
+};
+
+static const struct convert_func_map *convert_get_map(enum sof_ipc_frame fmt)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(func_map); i++) {
+		if (func_map[i].fmt == fmt)
+			return &func_map[i];
+	}
+
+	return NULL;
+}
+
+static struct comp_dev *convert_new(struct sof_ipc_comp *comp)
+{
+	struct comp_dev *dev;
+	struct sof_ipc_comp_convert *conv;
+	struct sof_ipc_comp_convert *ipc_conv =
+		(struct sof_ipc_comp_convert *)comp;
+	struct comp_data *cd;
+
+	trace_convert("new");
+
+	if (ipc_conv->sink_channels > CONVERT_MAX_CHANNELS) {
+		trace_convert_error("eCh");
+		return NULL;
+	}
+
+	dev = rzalloc(RZONE_RUNTIME, RFLAGS_NONE,
+		COMP_SIZE(struct sof_ipc_comp_convert));
+	if (dev == NULL)
+		return NULL;
+
+	conv = (struct sof_ipc_comp_convert *)&dev->comp;
+	memcpy(conv, ipc_conv, sizeof(struct sof_ipc_comp_convert));
+
+	cd = rzalloc(RZONE_RUNTIME, RFLAGS_NONE, sizeof(*cd));
+	if (cd == NULL) {
+		rfree(dev);
+		return NULL;
+	}
+
+	comp_set_drvdata(dev, cd);
+
+	/* pipeline negotiates the channels downstream of us */
+	dev->sink_channels = conv->sink_channels;
+
+	return dev;
+}
+
+static void convert_free(struct comp_dev *dev)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+
+	rfree(cd);
+	rfree(dev);
+}
+
+/* set component audio stream parameters */
+static int convert_params(struct comp_dev *dev, struct stream_params *params)
+{
+	trace_convert("par");
+
+	/* only PCM can be converted */
+	if (params->type != STREAM_TYPE_PCM)
+		return -EINVAL;
+
+	/* buffer formats and channels are negotiated by the pipeline */
+	comp_buffer_sink_params(dev, params);
+
+	return 0;
+}
+
+/* used to pass standard and bespoke commands (with data) to component */
+static int convert_cmd(struct comp_dev *dev, int cmd, void *data)
+{
+	switch (cmd) {
+	case COMP_CMD_START:
+	case COMP_CMD_RELEASE:
+		dev->state = COMP_STATE_RUNNING;
+		break;
+	case COMP_CMD_STOP:
+		if (dev->state == COMP_STATE_RUNNING ||
+		    dev->state == COMP_STATE_DRAINING ||
+		    dev->state == COMP_STATE_PAUSED) {
+			comp_buffer_reset(dev);
+			dev->state = COMP_STATE_SETUP;
+		}
+		break;
+	case COMP_CMD_PAUSE:
+		/* only support pausing for running */
+		if (dev->state == COMP_STATE_RUNNING)
+			dev->state = COMP_STATE_PAUSED;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/* convert span of at most CONVERT_SPAN frames */
+static inline void convert_span(struct comp_data *cd, void *src, void *dst,
+	uint32_t frames)
+{
+	cd->unpack(src, cd->in, frames * cd->source_channels);
+	cd->remix(cd, frames);
+	cd->pack(cd->remix == remix_none ? cd->in : cd->out,
+		dst, frames * cd->sink_channels);
+}
+
+/* copy and convert stream data from source to sink buffers */
+static int convert_copy(struct comp_dev *dev)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	struct comp_buffer *sink, *source;
+	uint32_t cframes = dev->period_frames, frames, n, limit;
+
+	tracev_convert("cpy");
+
+	/* converter will only ever have 1 source and 1 sink buffer */
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+
+	/* check for underrun and overrun */
+	if (source->avail < cframes * source->frame_size) {
+		comp_buffer_xrun(source, BUFFER_XRUN_UNDERRUN);
+		cframes = source->avail / source->frame_size;
+	}
+	if (sink->free < cframes * sink->frame_size) {
+		comp_buffer_xrun(sink, BUFFER_XRUN_OVERRUN);
+		cframes = sink->free / sink->frame_size;
+	}
+
+	/* convert a span at a time, spans end at buffer wrap */
+	for (frames = 0; frames < cframes; frames += n) {
+		n = cframes - frames;
+		if (n > CONVERT_SPAN)
+			n = CONVERT_SPAN;
+
+		limit = (source->end_addr - source->r_ptr) / source->frame_size;
+		if (n > limit)
+			n = limit;
+		limit = (sink->end_addr - sink->w_ptr) / sink->frame_size;
+		if (n > limit)
+			n = limit;
+
+		/* buffer sizes are frame aligned at prepare */
+		if (n == 0)
+			break;
+
+		convert_span(cd, source->r_ptr, sink->w_ptr, n);
+
+		source->r_ptr += n * source->frame_size;
+		if (source->r_ptr >= source->end_addr)
+			source->r_ptr = source->addr;
+		sink->w_ptr += n * sink->frame_size;
+		if (sink->w_ptr >= sink->end_addr)
+			sink->w_ptr = sink->addr;
+	}
+
+	/* calc new free and available */
+	comp_update_buffer_consume(source);
+	comp_update_buffer_produce(sink);
+
+	/* number of frames sent downstream */
+	return frames;
+}
+
+/* convert span of fused run */
+static int convert_process(struct comp_dev *dev, void *src, void *dst,
+	uint32_t frames)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	struct comp_buffer *source, *sink;
+	uint32_t n;
+
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+
+	for (; frames > 0; frames -= n) {
+		n = frames > CONVERT_SPAN ? CONVERT_SPAN : frames;
+		convert_span(cd, src, dst, n);
+		src += n * source->frame_size;
+		dst += n * sink->frame_size;
+	}
+
+	return 0;
+}
+
+static int convert_prepare(struct comp_dev *dev)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	struct comp_buffer *sink, *source;
+	const struct convert_func_map *map;
+
+	trace_convert("pre");
+
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+
+	cd->source_channels = source->channels;
+	cd->sink_channels = sink->channels;
+	if (cd->source_channels == 0 ||
+		cd->source_channels > CONVERT_MAX_CHANNELS ||
+		cd->sink_channels == 0 ||
+		cd->sink_channels > CONVERT_MAX_CHANNELS) {
+		trace_convert_error("ePc");
+		return -EINVAL;
+	}
+
+	map = convert_get_map(source->frame_fmt);
+	if (map == NULL) {
+		trace_convert_error("ePs");
+		return -EINVAL;
+	}
+	cd->unpack = map->unpack;
+
+	map = convert_get_map(sink->frame_fmt);
+	if (map == NULL) {
+		trace_convert_error("ePk");
+		return -EINVAL;
+	}
+	cd->pack = map->pack;
+
+	/* spans end at buffer wrap so buffers must hold whole frames */
+	if (source->ipc_buffer.size % source->frame_size ||
+		sink->ipc_buffer.size % sink->frame_size) {
+		trace_error2(TRACE_CLASS_CONVERT, "ePa",
+			source->ipc_buffer.size, sink->ipc_buffer.size);
+		return -EINVAL;
+	}
+
+	if (cd->source_channels == cd->sink_channels)
+		cd->remix = remix_none;
+	else if (cd->source_channels == 1)
+		cd->remix = remix_dup;
+	else if (cd->sink_channels == 1)
+		cd->remix = remix_avg;
+	else
+		cd->remix = remix_map;
+
+	dev->state = COMP_STATE_PREPARE;
+	return 0;
+}
+
+static int convert_reset(struct comp_dev *dev)
+{
+	dev->state = COMP_STATE_INIT;
+
+	return 0;
+}
+
+struct comp_driver comp_convert = {
+	.type	= SOF_COMP_CONVERT,
+	.flags	= COMP_DRV_FMT_CONVERT | COMP_DRV_PERIOD,
+	.formats_in	= CONVERT_FORMATS,
+	.formats_out	= CONVERT_FORMATS,
+	.ops	= {
+		.new		= convert_new,
+		.free		= convert_free,
+		.params		= convert_params,
+		.cmd		= convert_cmd,
+		.copy		= convert_copy,
+		.process	= convert_process,
+		.prepare	= convert_prepare,
+		.reset		= convert_reset,
+	},
+};
+
+void sys_comp_convert_init(void)
+{
+	comp_register(&comp_convert);
+}
@@ -43,7 +43,7 @@
 #include <reef/audio/component.h>
 #include <reef/audio/pipeline.h>
 #include <platform/dma.h>
-#include <arch/cache.h>
+#include <reef/cache.h>
 
 #define DAI_PLAYBACK_STREAM	0
 #define DAI_CAPTURE_STREAM	1
@@ -65,6 +65,7 @@ struct dai_data {
 	struct dma *dma;
 
 	uint32_t last_bytes;    /* the last bytes(<period size) it copies. */
+	uint32_t irq_bytes;	/* bytes copied by DMA per IRQ */
 	uint32_t dai_pos_blks;	/* position in bytes (nearest block) */
 
 	volatile uint64_t *dai_pos; /* host can read back this value without IPC */
@@ -85,7 +86,12 @@ static void dai_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 		dma_buffer = list_first_item(&dev->bsource_list,
 			struct comp_buffer, sink_list);
 
-		copied_size = dd->last_bytes ? dd->last_bytes : dev->period_bytes;
+		copied_size = dd->last_bytes ? dd->last_bytes : dd->irq_bytes;
+
+		/* DMA has read data not yet produced by pipeline ? */
+		if (dma_buffer->avail < copied_size)
+			comp_buffer_xrun(dma_buffer, BUFFER_XRUN_UNDERRUN);
+
 		dma_buffer->r_ptr += copied_size;
 
 		/* check for end of buffer */
@@ -96,7 +102,8 @@ static void dai_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 		}
 
 		/* writeback buffer contents from cache */
-		dcache_writeback_region(dma_buffer->r_ptr, dev->period_bytes);
+		dcache_ring_region(DCACHE_WRITEBACK, dma_buffer->r_ptr,
+			dd->irq_bytes, dma_buffer->addr, dma_buffer->end_addr);
 
 #if 0
 		// TODO: move this to new trace mechanism
@@ -104,7 +111,7 @@ static void dai_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 #endif
 
 		/* update host position(in bytes offset) for drivers */
-		dd->dai_pos_blks += dev->period_bytes;
+		dd->dai_pos_blks += dd->irq_bytes;
 		if (dd->dai_pos)
 			*dd->dai_pos = dd->dai_pos_blks +
 				dma_buffer->r_ptr - dma_buffer->addr;
@@ -115,10 +122,15 @@ static void dai_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 		dma_buffer = list_first_item(&dev->bsink_list,
 			struct comp_buffer, source_list);
 
+		/* DMA has overwritten data not yet consumed by pipeline ? */
+		if (dma_buffer->free < dd->irq_bytes)
+			comp_buffer_xrun(dma_buffer, BUFFER_XRUN_OVERRUN);
+
 		/* invalidate buffer contents */
-		dcache_writeback_region(dma_buffer->w_ptr, dev->period_bytes);
+		dcache_ring_region(DCACHE_INVALIDATE, dma_buffer->w_ptr,
+			dd->irq_bytes, dma_buffer->addr, dma_buffer->end_addr);
 
-		dma_buffer->w_ptr += dev->period_bytes;
+		dma_buffer->w_ptr += dd->irq_bytes;
 
 		/* check for end of buffer */
 		if (dma_buffer->w_ptr >= dma_buffer->end_addr) {
@@ -141,7 +153,7 @@ static void dai_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 	}
 
 	if (dd->direction == SOF_IPC_STREAM_PLAYBACK &&
-				dma_buffer->avail < dev->period_bytes) {
+				dma_buffer->avail < dd->irq_bytes) {
 		/* end of stream, finish */
 		if (dma_buffer->avail == 0) {
 			dai_cmd(dev, COMP_CMD_STOP, NULL);
@@ -167,8 +179,15 @@ static void dai_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 
 	}
 
+	/* timer scheduled pipelines only need the timer realigned */
+	if (pipeline_is_timer(dev->pipeline)) {
+		pipeline_timer_align(dev->pipeline);
+		return;
+	}
+
 	/* notify pipeline that DAI needs it's buffer processed */
-	pipeline_schedule_copy(dev->pipeline, dev, PLAT_DAI_SCHED, TASK_PRI_HIGH);
+	pipeline_schedule_copy(dev->pipeline, dev, dev->pipeline->deadline,
+		dev->pipeline->priority);
 
 next_copy:
 
@@ -240,12 +259,27 @@ static void dai_free(struct comp_dev *dev)
 {
 	struct dai_data *dd = comp_get_drvdata(dev);
 
-	dma_channel_put(dd->dma, dd->chan);
+	if (dd->chan >= 0)
+		dma_channel_put(dd->dma, dd->chan);
 
 	rfree(dd);
 	rfree(dev);
 }
 
+/* DMA IRQ every pipeline dma_periods if the buffer splits evenly into them */
+static void dai_irq_bytes_set(struct comp_dev *dev, int period_count)
+{
+	struct dai_data *dd = comp_get_drvdata(dev);
+	uint32_t periods = dev->pipeline->dma_periods;
+
+	if (periods == 0 || period_count % periods) {
+		trace_dai_error("wDi");
+		periods = 1;
+	}
+
+	dd->irq_bytes = periods * dev->period_bytes;
+}
+
 /* set component audio SSP and DMA configuration */
 static int dai_playback_params(struct comp_dev *dev,
 	struct stream_params *params)
@@ -255,7 +289,7 @@ static int dai_playback_params(struct comp_dev *dev,
 	struct dma_sg_elem *elem;
 	struct comp_buffer *dma_buffer;
 	struct list_item *elist, *tlist;
-	int i, period_count;
+	int i, period_count, elem_count;
 
 	dd->direction = params->pcm->direction;
 
@@ -280,20 +314,27 @@ static int dai_playback_params(struct comp_dev *dev,
 		return -EINVAL;
 	}
 
-	/* set it to dai stream format, for volume func correct mapping */
-	dma_buffer->params.pcm->frame_fmt = dd->stream_format;
+	/* DAI format is fixed so negotiation must have picked it */
+	if (dma_buffer->frame_fmt != dd->stream_format) {
+		trace_dai_error("eDf");
+		return -EINVAL;
+	}
+
+	/* each DMA elem raises an IRQ so may cover several periods */
+	dai_irq_bytes_set(dev, period_count);
+	elem_count = dma_buffer->size / dd->irq_bytes;
 
 	if (list_is_empty(&config->elem_list)) {
 		/* set up cyclic list of DMA elems */
-		for (i = 0; i < period_count; i++) {
+		for (i = 0; i < elem_count; i++) {
 
 			elem = rzalloc(RZONE_RUNTIME, RFLAGS_NONE, sizeof(*elem));
 			if (elem == NULL)
 				goto err_unwind;
 
-			elem->size = dev->period_bytes;
+			elem->size = dd->irq_bytes;
 			elem->src = (uint32_t)(dma_buffer->r_ptr) +
-				i * dev->period_bytes;
+				i * dd->irq_bytes;
 
 			elem->dest = dai_fifo(dd->dai, params->pcm->direction);
 
@@ -323,7 +364,7 @@ static int dai_capture_params(struct comp_dev *dev,
 	struct dma_sg_elem *elem;
 	struct comp_buffer *dma_buffer;
 	struct list_item *elist, *tlist;
-	int i, period_count;
+	int i, period_count, elem_count;
 
 	dd->direction = params->pcm->direction;
 
@@ -348,20 +389,27 @@ static int dai_capture_params(struct comp_dev *dev,
 		return -EINVAL;
 	}
 
-	/* set it to dai stream format, for volume func correct mapping */
-	dma_buffer->params.pcm->frame_fmt = dd->stream_format;
+	/* DAI format is fixed so negotiation must have picked it */
+	if (dma_buffer->frame_fmt != dd->stream_format) {
+		trace_dai_error("eDf");
+		return -EINVAL;
+	}
+
+	/* each DMA elem raises an IRQ so may cover several periods */
+	dai_irq_bytes_set(dev, period_count);
+	elem_count = dma_buffer->size / dd->irq_bytes;
 
 	if (list_is_empty(&config->elem_list)) {
 		/* set up cyclic list of DMA elems */
-		for (i = 0; i < period_count; i++) {
+		for (i = 0; i < elem_count; i++) {
 
 			elem = rzalloc(RZONE_RUNTIME, RFLAGS_NONE, sizeof(*elem));
 			if (elem == NULL)
 				goto err_unwind;
 
-			elem->size = dev->period_bytes;
+			elem->size = dd->irq_bytes;
 			elem->dest = (uint32_t)(dma_buffer->w_ptr) +
-				i * dev->period_bytes;
+				i * dd->irq_bytes;
 			elem->src = dai_fifo(dd->dai, params->pcm->direction);
 			list_item_append(&elem->list, &config->elem_list);
 		}
@@ -491,10 +539,30 @@ static int dai_cmd(struct comp_dev *dev, int cmd, void *data)
 				return ret;
 			dai_trigger(dd->dai, cmd, dd->direction);
 			dev->state = COMP_STATE_RUNNING;
+			pipeline_first_sample(dev->pipeline);
 		}
 		break;
 	case COMP_CMD_SUSPEND:
+		/* channel state lives in DMA private data that is not saved */
+		if (dd->chan >= 0) {
+			dma_channel_put(dd->dma, dd->chan);
+			dd->chan = -1;
+		}
+		break;
 	case COMP_CMD_RESUME:
+		if (dd->chan >= 0)
+			break;
+		dd->chan = dma_channel_get(dd->dma);
+		if (dd->chan < 0) {
+			trace_dai_error("eDc");
+			return -ENODEV;
+		}
+		dma_set_cb(dd->dma, dd->chan, DMA_IRQ_TYPE_LLIST,
+			dai_dma_cb, dev);
+
+		/* reload the config a prepared stream had before suspend */
+		if (dev->state == COMP_STATE_PREPARE)
+			return dma_set_config(dd->dma, dd->chan, &dd->config);
 		break;
 	case COMP_CMD_IPC_MMAP_PPOS:
 		dd->dai_pos = data;
@@ -529,6 +597,8 @@ static int dai_config(struct comp_dev *dev, struct dai_config *dai_config)
 
 static struct comp_driver comp_dai = {
 	.type	= SOF_COMP_DAI,
+	.formats_in	= COMP_FMT(PLATFORM_SSP_STREAM_FORMAT),
+	.formats_out	= COMP_FMT(PLATFORM_SSP_STREAM_FORMAT),
 	.ops	= {
 		.new		= dai_new_ssp,
 		.free		= dai_free,
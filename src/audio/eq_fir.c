@@ -68,14 +68,14 @@ struct comp_data {
  * EQ FIR algorithm code
  */
 
-static void eq_fir_s32_default(struct comp_dev *dev,
+static void __hot_text eq_fir_s32_default(struct comp_dev *dev,
 	struct comp_buffer *source, struct comp_buffer *sink, uint32_t frames)
 {
 
 	int ch, n, n_wrap_src, n_wrap_snk, n_wrap_min;
 	int32_t *src = (int32_t *) source->r_ptr;
 	int32_t *snk = (int32_t *) sink->w_ptr;
-	int nch = source->params.pcm->channels;
+	int nch = source->channels;
 	int32_t *x = src + nch - 1;
 	int32_t *y = snk + nch - 1;
 	struct comp_data *cd = comp_get_drvdata(dev);
@@ -293,7 +293,7 @@ static int eq_fir_params(struct comp_dev *dev, struct stream_params *params)
 
 	/* EQ supports only S32_LE PCM format */
 	if ((params->type != STREAM_TYPE_PCM)
-		|| (params->pcm->frame_fmt != SOF_IPC_FRAME_S32_LE))
+		|| (comp_sink_frame_fmt(dev) != SOF_IPC_FRAME_S32_LE))
 		return -EINVAL;
 
 	/* don't do any data transformation */
@@ -323,9 +323,9 @@ static int eq_fir_cmd(struct comp_dev *dev, int cmd, void *data)
 			fir_update, PLATFORM_MAX_CHANNELS);
 
 		/* Print trace information */
-		tracev_value(iir_update->stream_max_channels);
+		tracev_value(fir_update->stream_max_channels);
 		for (i = 0; i < fir_update->stream_max_channels; i++)
-			tracev_value(iir_update->assign_response[i]);
+			tracev_value(fir_update->assign_response[i]);
 
 		break;
 	case COMP_CMD_EQ_FIR_CONFIG:
@@ -416,9 +416,9 @@ static int eq_fir_copy(struct comp_dev *dev)
 	/* Check that source has enough frames available and sink enough
 	 * frames free.
 	 */
-	frames = source->params.pcm->period_count;
-	need_source = frames * source->params.pcm->frame_size;
-	need_sink = frames * sink->params.pcm->frame_size;
+	frames = dev->period_frames;
+	need_source = frames * source->frame_size;
+	need_sink = frames * sink->frame_size;
 
 	/* Run EQ if buffers have enough room */
 	if ((source->avail >= need_source) && (sink->free >= need_sink))
@@ -427,6 +427,31 @@ static int eq_fir_copy(struct comp_dev *dev)
 	return 0;
 }
 
+/* filter span of fused run */
+static int __hot_text eq_fir_process(struct comp_dev *dev, void *src,
+	void *dst, uint32_t frames)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	struct comp_buffer *source;
+	int32_t *x = src;
+	int32_t *y = dst;
+	uint32_t i;
+	int ch, nch;
+
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	nch = source->channels;
+
+	for (i = 0; i < frames; i++) {
+		for (ch = 0; ch < nch; ch++)
+			y[ch] = fir_32x16(&cd->fir[ch], x[ch]);
+		x += nch;
+		y += nch;
+	}
+
+	return 0;
+}
+
 static int eq_fir_prepare(struct comp_dev *dev)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
@@ -443,24 +468,19 @@ static int eq_fir_prepare(struct comp_dev *dev)
 
 	source = list_first_item(&dev->bsource_list, struct comp_buffer,
 		sink_list);
-	ret = eq_fir_setup(cd->fir, cd->config, source->params.pcm->channels);
+	ret = eq_fir_setup(cd->fir, cd->config, source->channels);
 	if (ret < 0)
 		return ret;
 
-	//dev->preload = PLAT_INT_PERIODS;
 	dev->state = COMP_STATE_PREPARE;
 	return 0;
 }
 
 static int eq_fir_preload(struct comp_dev *dev)
 {
-	//int i;
-
 	trace_src("EPl");
-	//for (i = 0; i < dev->preload; i++)
-	//	eq_fir_copy(dev);
 
-	return 0;
+	return comp_preload_period(dev);
 }
 
 static int eq_fir_reset(struct comp_dev *dev)
@@ -483,12 +503,16 @@ static int eq_fir_reset(struct comp_dev *dev)
 
 struct comp_driver comp_eq_fir = {
 	.type = SOF_COMP_EQ_FIR,
+	.flags = COMP_DRV_INPLACE | COMP_DRV_PERIOD,
+	.formats_in = COMP_FMT(SOF_IPC_FRAME_S32_LE),
+	.formats_out = COMP_FMT(SOF_IPC_FRAME_S32_LE),
 	.ops = {
 		.new = eq_fir_new,
 		.free = eq_fir_free,
 		.params = eq_fir_params,
 		.cmd = eq_fir_cmd,
 		.copy = eq_fir_copy,
+		.process = eq_fir_process,
 		.prepare = eq_fir_prepare,
 		.reset = eq_fir_reset,
 		.preload = eq_fir_preload,
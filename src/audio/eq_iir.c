@@ -68,14 +68,14 @@ struct comp_data {
  * EQ IIR algorithm code
  */
 
-static void eq_iir_s32_default(struct comp_dev *dev,
+static void __hot_text eq_iir_s32_default(struct comp_dev *dev,
 	struct comp_buffer *source, struct comp_buffer *sink, uint32_t frames)
 {
 
 	int ch, n, n_wrap_src, n_wrap_snk, n_wrap_min;
 	int32_t *src = (int32_t *) source->r_ptr;
 	int32_t *snk = (int32_t *) sink->w_ptr;
-	int nch = source->params.pcm->channels;
+	int nch = source->channels;
 	int32_t *x = src + nch - 1;
 	int32_t *y = snk + nch - 1;
 	struct comp_data *cd = comp_get_drvdata(dev);
@@ -298,7 +298,7 @@ static int eq_iir_params(struct comp_dev *dev, struct stream_params *params)
 
 	/* EQ supports only S32_LE PCM format */
 	if ((params->type != STREAM_TYPE_PCM)
-		|| (params->pcm->frame_fmt != SOF_IPC_FRAME_S32_LE))
+		|| (comp_sink_frame_fmt(dev) != SOF_IPC_FRAME_S32_LE))
 		return -EINVAL;
 
 	/* don't do any data transformation */
@@ -427,9 +427,9 @@ static int eq_iir_copy(struct comp_dev *dev)
 	/* Check that source has enough frames available and that sink has
 	 * enough frames free.
 	 */
-	frames = source->params.pcm->period_count;
-	need_source = frames * source->params.pcm->frame_size;
-	need_sink = frames * sink->params.pcm->frame_size;
+	frames = dev->period_frames;
+	need_source = frames * source->frame_size;
+	need_sink = frames * sink->frame_size;
 
 	/* Run EQ if buffers have enough room */
 	if ((source->avail >= need_source) && (sink->free >= need_sink))
@@ -438,6 +438,31 @@ static int eq_iir_copy(struct comp_dev *dev)
 	return 0;
 }
 
+/* filter span of fused run */
+static int __hot_text eq_iir_process(struct comp_dev *dev, void *src,
+	void *dst, uint32_t frames)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	struct comp_buffer *source;
+	int32_t *x = src;
+	int32_t *y = dst;
+	uint32_t i;
+	int ch, nch;
+
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	nch = source->channels;
+
+	for (i = 0; i < frames; i++) {
+		for (ch = 0; ch < nch; ch++)
+			y[ch] = iir_df2t(&cd->iir[ch], x[ch]);
+		x += nch;
+		y += nch;
+	}
+
+	return 0;
+}
+
 static int eq_iir_prepare(struct comp_dev *dev)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
@@ -457,25 +482,19 @@ static int eq_iir_prepare(struct comp_dev *dev)
 
 	source = list_first_item(&dev->bsource_list, struct comp_buffer,
 		sink_list);
-	ret = eq_iir_setup(cd->iir, cd->config, source->params.pcm->channels);
+	ret = eq_iir_setup(cd->iir, cd->config, source->channels);
 	if (ret < 0)
 		return ret;
 
-	//dev->preload = PLAT_INT_PERIODS;
 	dev->state = COMP_STATE_PREPARE;
 	return 0;
 }
 
 static int eq_iir_preload(struct comp_dev *dev)
 {
-	//int i;
-
 	trace_eq_iir("EPl");
 
-	//for (i = 0; i < dev->preload; i++)
-	//    eq_iir_copy(dev);
-
-	return 0;
+	return comp_preload_period(dev);
 }
 
 static int eq_iir_reset(struct comp_dev *dev)
@@ -498,12 +517,16 @@ static int eq_iir_reset(struct comp_dev *dev)
 
 struct comp_driver comp_eq_iir = {
 	.type = SOF_COMP_EQ_IIR,
+	.flags = COMP_DRV_INPLACE | COMP_DRV_PERIOD,
+	.formats_in = COMP_FMT(SOF_IPC_FRAME_S32_LE),
+	.formats_out = COMP_FMT(SOF_IPC_FRAME_S32_LE),
 	.ops = {
 		.new = eq_iir_new,
 		.free = eq_iir_free,
 		.params = eq_iir_params,
 		.cmd = eq_iir_cmd,
 		.copy = eq_iir_copy,
+		.process = eq_iir_process,
 		.prepare = eq_iir_prepare,
 		.reset = eq_iir_reset,
 		.preload = eq_iir_preload,
@@ -44,7 +44,8 @@
 #include <reef/audio/component.h>
 #include <reef/audio/pipeline.h>
 #include <platform/dma.h>
-#include <arch/cache.h>
+#include <platform/timer.h>
+#include <reef/cache.h>
 #include <uapi/ipc.h>
 
 #define trace_host(__e)	trace_event(TRACE_CLASS_HOST, __e)
@@ -66,6 +67,8 @@ struct host_data {
 	completion_t complete;
 	struct comp_buffer *dma_buffer;
 	int period_count;
+	uint32_t xfer_bytes;		/* bytes per host DMA copy */
+	uint32_t deep_buffer;		/* copy half of buffer per host DMA */
 
 	/* local and host DMA buffer info */
 	struct hc_buf host;
@@ -76,6 +79,10 @@ struct host_data {
 	uint32_t report_period; 	/* host_pos report/update to host side period, in bytes */
 	uint32_t report_pos;		/* position in current report period */
 	uint32_t local_pos;		/* the host side buffer local read/write possition, in bytes */
+	int posn_entry;			/* position table entry or negative if none */
+	uint32_t notify_bytes;		/* host position IPC interval, in bytes */
+	uint32_t notify_period;		/* position IPC notification period, in bytes */
+	uint32_t notify_pos;		/* position in current notification period */
 	/* pointers set during params to host or local above */
 	struct hc_buf *source;
 	struct hc_buf *sink;
@@ -116,6 +123,7 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 	struct dma_sg_elem *local_elem, *source_elem, *sink_elem;
 	struct comp_buffer *dma_buffer;
 	uint32_t next_size, need_copy = 0;
+	int notify, xrun;
 
 	local_elem = list_first_item(&hd->config.elem_list,
 		struct dma_sg_elem, list);
@@ -126,13 +134,20 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 	dma_buffer = hd->dma_buffer;
 
 	if (hd->params.pcm->direction == SOF_IPC_STREAM_PLAYBACK) {
-		dma_buffer->w_ptr += local_elem->size;
+		/* DMA has overwritten data not yet consumed by pipeline ? */
+		xrun = dma_buffer->free < local_elem->size;
+		if (xrun)
+			comp_buffer_xrun(dma_buffer, BUFFER_XRUN_OVERRUN);
 
-		/* invalidate audio data */
-		dcache_invalidate_region(dma_buffer->w_ptr, local_elem->size);
+		dma_buffer->w_ptr += local_elem->size;
 
 		if (dma_buffer->w_ptr >= dma_buffer->end_addr)
 			dma_buffer->w_ptr = dma_buffer->addr;
+
+		/* invalidate audio data */
+		dcache_ring_region(DCACHE_INVALIDATE, dma_buffer->w_ptr,
+			local_elem->size, dma_buffer->addr,
+			dma_buffer->end_addr);
 #if 0
 		trace_value((uint32_t)(hd->dma_buffer->w_ptr - hd->dma_buffer->addr));
 #endif
@@ -140,6 +155,11 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 		/* recalc available buffer space */
 		comp_update_buffer_produce(hd->dma_buffer);
 	} else {
+		/* DMA has read data not yet produced by pipeline ? */
+		xrun = dma_buffer->avail < local_elem->size;
+		if (xrun)
+			comp_buffer_xrun(dma_buffer, BUFFER_XRUN_UNDERRUN);
+
 		dma_buffer->r_ptr += local_elem->size;
 
 		if (dma_buffer->r_ptr >= dma_buffer->end_addr)
@@ -149,7 +169,9 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 #endif
 
 		/* writeback audio data */
-		dcache_writeback_region(dma_buffer->r_ptr, local_elem->size);
+		dcache_ring_region(DCACHE_WRITEBACK, dma_buffer->r_ptr,
+			local_elem->size, dma_buffer->addr,
+			dma_buffer->end_addr);
 
 		/* recalc available buffer space */
 		comp_update_buffer_consume(hd->dma_buffer);
@@ -162,13 +184,27 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 	if (hd->local_pos >= hd->host_size)
 		hd->local_pos = 0;
 
-	/* send IPC message to driver if needed */
+	/* update position table every period, notify host at notify period */
 	hd->report_pos += local_elem->size;
-	if (hd->report_pos >= hd->report_period) {
+	if (hd->report_pos >= hd->report_period || xrun) {
+
+		hd->notify_pos += hd->report_pos;
 		hd->report_pos = 0;
+		notify = hd->notify_pos >= hd->notify_period;
+		if (notify)
+			hd->notify_pos = 0;
+
 		/* update for host side */
-		if (hd->host_pos) {
+		if (hd->host_pos)
 			*hd->host_pos = hd->local_pos;
+		if (hd->posn_entry >= 0)
+			ipc_stream_posn_update(hd->posn_entry, hd->local_pos,
+				notify, xrun);
+		else {
+			/* no table entry so notify every report period */
+			hd->posn.host_posn = hd->params.pcm->frame_size ?
+				hd->local_pos / hd->params.pcm->frame_size : 0;
+			hd->posn.timestamp = platform_timer_get(NULL);
 			ipc_stream_send_notification(dev, &hd->posn);
 		}
 	}
@@ -190,7 +226,7 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 	}
 
 	/* calc size of next transfer */
-	next_size = dev->period_bytes;
+	next_size = hd->xfer_bytes;
 	if (local_elem->src + next_size > hd->source->current_end)
 		next_size = hd->source->current_end - local_elem->src;
 	if (local_elem->dest + next_size > hd->sink->current_end)
@@ -199,8 +235,8 @@ static void host_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
 	/* are we dealing with a split transfer ? */
 	if (!hd->split_remaining) {
 		/* no, is next transfer split ? */
-		if (next_size != dev->period_bytes)
-			hd->split_remaining = dev->period_bytes - next_size;
+		if (next_size != hd->xfer_bytes)
+			hd->split_remaining = hd->xfer_bytes - next_size;
 	} else {
 		/* yes, than calc transfer size */
 		need_copy = 1;
@@ -255,6 +291,7 @@ static struct comp_dev *host_new(struct sof_ipc_comp *comp)
 
 	comp_set_drvdata(dev, hd);
 	comp_set_endpoint(dev);
+	hd->posn_entry = -ENODEV;
 
 	hd->dma = dma_get(DMA_ID_DMAC0);
 	if (hd->dma == NULL)
@@ -292,7 +329,8 @@ static void host_free(struct comp_dev *dev)
 
 	elem = list_first_item(&hd->config.elem_list,
 		struct dma_sg_elem, list);
-	dma_channel_put(hd->dma, hd->chan);
+	if (hd->chan >= 0)
+		dma_channel_put(hd->dma, hd->chan);
 
 	rfree(elem);
 	rfree(hd);
@@ -315,12 +353,12 @@ static int create_local_elems(struct comp_dev *dev,
 
 		if (params->pcm->direction == SOF_IPC_STREAM_PLAYBACK)
 			e->dest = (uint32_t)(hd->dma_buffer->addr) +
-				i * dev->period_bytes;
+				i * hd->xfer_bytes;
 		else
 			e->src = (uint32_t)(hd->dma_buffer->addr) +
-				i * dev->period_bytes;
+				i * hd->xfer_bytes;
 
-		e->size = dev->period_bytes;
+		e->size = hd->xfer_bytes;
 
 		list_item_append(&e->list, &hd->local.elem_list);
 	}
@@ -358,9 +396,9 @@ static int host_elements_reset(struct comp_dev *dev)
 	local_elem = list_first_item(&hd->config.elem_list,
 		struct dma_sg_elem, list);
 	local_elem->dest = sink_elem->dest;
-	local_elem->size = dev->period_bytes;
+	local_elem->size = hd->xfer_bytes;
 	local_elem->src = source_elem->src;
-	hd->next_inc = dev->period_bytes;
+	hd->next_inc = hd->xfer_bytes;
 
 	return 0;
 }
@@ -400,11 +438,29 @@ static int host_params(struct comp_dev *dev, struct stream_params *params)
 		config->direction = DMA_DIR_LMEM_TO_HMEM;
 	}
 
-	hd->period_count = hd->dma_buffer->size / dev->period_bytes;
+	/* deep buffer pipelines refill half of the buffer per host DMA copy */
+	if (dev->pipeline->ipc_pipe.flags & SOF_IPC_PIPE_FLAG_DEEP_BUFFER) {
+		hd->deep_buffer = 1;
+		hd->xfer_bytes = (hd->dma_buffer->size >> 1) /
+			dev->period_bytes * dev->period_bytes;
+
+		/* buffer must be deep enough for the host link to idle */
+		if (hd->xfer_bytes <
+			PLAT_HOST_DEEP_PERIODS * dev->period_bytes) {
+			trace_error2(TRACE_CLASS_HOST, "eDb",
+				hd->dma_buffer->size, dev->period_bytes);
+			return -EINVAL;
+		}
+	} else {
+		hd->deep_buffer = 0;
+		hd->xfer_bytes = dev->period_bytes;
+	}
+
+	hd->period_count = hd->dma_buffer->size / hd->xfer_bytes;
 
-	/* resize the buffer if space is available to align with period size */
-	if (hd->period_count * dev->period_bytes <= hd->dma_buffer->alloc_size)
-		hd->dma_buffer->size = hd->period_count * dev->period_bytes;
+	/* resize the buffer if space is available to align with copy size */
+	if (hd->period_count * hd->xfer_bytes <= hd->dma_buffer->alloc_size)
+		hd->dma_buffer->size = hd->period_count * hd->xfer_bytes;
 	else {
 		trace_host_error("eSz");
 		return -EINVAL;
@@ -413,9 +469,8 @@ static int host_params(struct comp_dev *dev, struct stream_params *params)
 
 	/* component buffer size must be divisor of host buffer size */
 	if (hd->host_size % dev->period_bytes) {
-		trace_comp_error("eHB");
-		trace_value(hd->host_size);
-		trace_value(dev->period_bytes);
+		trace_error2(TRACE_CLASS_COMP, "eHB", hd->host_size,
+			dev->period_bytes);
 		return -EINVAL;
 	}
 
@@ -436,34 +491,36 @@ static int host_params(struct comp_dev *dev, struct stream_params *params)
 	return 0;
 }
 
-/* preload the local buffers with available host data before start */
+/* transfer one period between host and local buffer and wait for it */
+static int host_dma_copy(struct host_data *hd)
+{
+	/* do DMA transfer */
+	wait_init(&hd->complete);
+	dma_set_config(hd->dma, hd->chan, &hd->config);
+	dma_start(hd->dma, hd->chan);
+
+	/* wait for DMA to finish */
+	hd->complete.timeout = PLATFORM_DMA_TIMEOUT;
+	return wait_for_completion_timeout(&hd->complete);
+}
+
+/* preload a period of playback host data before start */
 static int host_preload(struct comp_dev *dev)
 {
-#if 0
 	struct host_data *hd = comp_get_drvdata(dev);
-	int ret = 0, i;
+	int ret;
 
 	trace_host("PrL");
 
-	/* preload all periods */
-	for (i = 0; i < dev->preload; i++) {
-		/* do DMA transfer */
-		wait_init(&hd->complete);
-		dma_set_config(hd->dma, hd->chan, &hd->config);
-		dma_start(hd->dma, hd->chan);
-
-		/* wait for DMA to finish */
-		hd->complete.timeout = PLATFORM_DMA_TIMEOUT;
-		ret = wait_for_completion_timeout(&hd->complete);
-		if (ret < 0) {
-			trace_comp_error("eHp");
-			break;
-		}
-	}
+	if (hd->params.pcm->direction != SOF_IPC_STREAM_PLAYBACK ||
+		hd->dma_buffer->free < hd->xfer_bytes)
+		return 0;
+
+	ret = host_dma_copy(hd);
+	if (ret < 0)
+		trace_comp_error("eHp");
 
 	return ret;
-#endif
-	return 0;
 }
 
 static int host_prepare(struct comp_dev *dev)
@@ -484,9 +541,27 @@ static int host_prepare(struct comp_dev *dev)
 		*hd->host_pos = 0;
 	hd->report_pos = 0;
 	hd->report_period = hd->params.pcm->period_bytes;
+
+	/* deep buffer only updates position once per refill */
+	if (hd->deep_buffer && hd->report_period < hd->xfer_bytes)
+		hd->report_period = hd->xfer_bytes;
+
 	hd->split_remaining = 0;
 
-	//dev->preload = PLAT_HOST_PERIODS;
+	/* position notification period is at least one report period */
+	hd->notify_pos = 0;
+	hd->notify_period = hd->notify_bytes;
+	if (hd->notify_period < hd->report_period)
+		hd->notify_period = hd->report_period;
+
+	/* get position table entry for stream */
+	if (hd->posn_entry < 0)
+		hd->posn_entry = ipc_stream_posn_get(dev->comp.id);
+
+	/* single stream notification if the table is full */
+	hd->posn.hdr.cmd = SOF_IPC_GLB_STREAM_MSG | SOF_IPC_STREAM_POSITION;
+	hd->posn.hdr.size = sizeof(hd->posn);
+	hd->posn.comp_id = dev->comp.id;
 
 	dev->state = COMP_STATE_PREPARE;
 	return 0;
@@ -501,6 +576,7 @@ static int host_pointer_reset(struct comp_dev *dev)
 		*hd->host_pos = 0;
 	hd->local_pos = 0;
 	hd->report_pos = 0;
+	hd->notify_pos = 0;
 
 	return 0;
 }
@@ -523,6 +599,7 @@ static int host_stop(struct comp_dev *dev)
 /* used to pass standard and bespoke commands (with data) to component */
 static int host_cmd(struct comp_dev *dev, int cmd, void *data)
 {
+	struct host_data *hd = comp_get_drvdata(dev);
 	int ret = 0;
 
 	// TODO: align cmd macros.
@@ -546,7 +623,32 @@ static int host_cmd(struct comp_dev *dev, int cmd, void *data)
 		dev->state = COMP_STATE_RUNNING;
 		break;
 	case COMP_CMD_SUSPEND:
+		/* channel state lives in DMA private data that is not saved */
+		if (hd->chan >= 0) {
+			dma_channel_put(hd->dma, hd->chan);
+			hd->chan = -1;
+		}
+		break;
 	case COMP_CMD_RESUME:
+		/* config is set on each copy so only channel and cb needed */
+		if (hd->chan < 0) {
+			hd->chan = dma_channel_get(hd->dma);
+			if (hd->chan < 0) {
+				trace_host_error("eDC");
+				return -ENODEV;
+			}
+			dma_set_cb(hd->dma, hd->chan, DMA_IRQ_TYPE_LLIST,
+				host_dma_cb, dev);
+		}
+		break;
+	case COMP_CMD_POSN_NOTIFY:
+		/* used from next prepare, or now if already prepared */
+		hd->notify_bytes = *(uint32_t *)data;
+		if (hd->report_period) {
+			hd->notify_period = hd->notify_bytes;
+			if (hd->notify_period < hd->report_period)
+				hd->notify_period = hd->report_period;
+		}
 		break;
 	default:
 		break;
@@ -598,6 +700,12 @@ static int host_reset(struct comp_dev *dev)
 	host_pointer_reset(dev);
 	hd->host_pos = NULL;
 
+	/* release position table entry */
+	if (hd->posn_entry >= 0) {
+		ipc_stream_posn_put(hd->posn_entry);
+		hd->posn_entry = -ENODEV;
+	}
+
 	hd->report_period = 0;
 	hd->source = NULL;
 	hd->sink = NULL;
@@ -612,18 +720,20 @@ static int host_copy(struct comp_dev *dev)
 	struct host_data *hd = comp_get_drvdata(dev);
 	int ret;
 
-	trace_host("CpS");
+	tracev_host("CpS");
 	if (dev->state != COMP_STATE_RUNNING)
 		return 0;
 
-	/* do DMA transfer */
-	wait_init(&hd->complete);
-	dma_set_config(hd->dma, hd->chan, &hd->config);
-	dma_start(hd->dma, hd->chan);
+	/* deep buffer waits until a whole refill fits */
+	if (hd->deep_buffer) {
+		if (hd->params.pcm->direction == SOF_IPC_STREAM_PLAYBACK) {
+			if (hd->dma_buffer->free < hd->xfer_bytes)
+				return 0;
+		} else if (hd->dma_buffer->avail < hd->xfer_bytes)
+			return 0;
+	}
 
-	/* wait for DMA to finish */
-	hd->complete.timeout = PLATFORM_DMA_TIMEOUT;
-	ret = wait_for_completion_timeout(&hd->complete);
+	ret = host_dma_copy(hd);
 	if (ret < 0)
 		trace_comp_error("eHc");
 
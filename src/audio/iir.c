@@ -38,6 +38,7 @@
 #include <stdio.h>
 #endif
 
+#include <reef/reef.h>
 #include <reef/audio/format.h>
 #include "iir.h"
 
@@ -70,7 +71,7 @@
 
 /* 32 bit data, 32 bit coefficients and 64 bit state variables */
 
-int32_t iir_df2t(struct iir_state_df2t *iir, int32_t x)
+int32_t __hot_text iir_df2t(struct iir_state_df2t *iir, int32_t x)
 {
 	int32_t in, tmp;
 	int64_t acc;
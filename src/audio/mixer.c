@@ -47,15 +47,51 @@ struct mixer_data {
 		struct comp_buffer **sources, uint32_t count, uint32_t frames);
 };
 
-/* mix N PCM source streams to one sink stream */
-static void mix_n(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer **sources, uint32_t num_sources, uint32_t frames)
+/* mix N 16 bit PCM source streams to one sink stream */
+static void __hot_text mix_n_s16(struct comp_dev *dev,
+	struct comp_buffer *sink, struct comp_buffer **sources,
+	uint32_t num_sources, uint32_t frames)
+{
+	int16_t *src, *dest = sink->w_ptr;
+	int32_t val[2], count;
+	int i, j;
+
+	count = frames * sink->channels;
+
+	for (i = 0; i < count; i += 2) {
+		val[0] = 0;
+		val[1] = 0;
+		for (j = 0; j < num_sources; j++) {
+			src = sources[j]->r_ptr;
+
+			/* TODO: clamp */
+			val[0] += src[i];
+			val[1] += src[i + 1];
+		}
+
+		/* TODO: best place for attenuation ? */
+		dest[i] = (val[0] >> (num_sources >> 1));
+		dest[i + 1] = (val[1] >> (num_sources >> 1));
+	}
+
+	/* update R/W pointers */
+	sink->w_ptr = dest + count;
+	for (j = 0; j < num_sources; j++) {
+		src = sources[j]->r_ptr;
+		sources[j]->r_ptr = src + count;
+	}
+}
+
+/* mix N 24 or 32 bit PCM source streams to one sink stream */
+static void __hot_text mix_n(struct comp_dev *dev,
+	struct comp_buffer *sink, struct comp_buffer **sources,
+	uint32_t num_sources, uint32_t frames)
 {
 	int32_t *src, *dest = sink->w_ptr, count;
 	int64_t val[2];
 	int i, j;
 
-	count = frames * sink->params.pcm->channels;
+	count = frames * sink->channels;
 
 	for (i = 0; i < count; i += 2) {
 		val[0] = 0;
@@ -119,18 +155,12 @@ static void mixer_free(struct comp_dev *dev)
 /* set component audio stream parameters */
 static int mixer_params(struct comp_dev *dev, struct stream_params *params)
 {
-	struct stream_params sink_params = *params;
-
 	/* dont do any params downstream setting for running mixer stream */
 	if (dev->state == COMP_STATE_RUNNING)
 		return 1;
 
-	/* suppose sink component won't be host/dai, so hard code it */
-	sink_params.pcm->frame_fmt = SOF_IPC_FRAME_S32_LE;
-	sink_params.pcm->frame_size = 4 * params->pcm->channels; /* 32bit container */
-
-	/* dont do any data transformation */
-	comp_buffer_sink_params(dev, &sink_params);
+	/* dont do any data transformation - format was negotiated */
+	comp_buffer_sink_params(dev, params);
 
 	return 0;
 }
@@ -189,7 +219,7 @@ static int mixer_copy(struct comp_dev *dev)
 {
 	struct mixer_data *md = comp_get_drvdata(dev);
 	struct comp_buffer *sink, *sources[5], *source;
-	uint32_t i = 0, num_mix_sources, cframes = PLAT_INT_PERIOD_FRAMES;
+	uint32_t i = 0, num_mix_sources, cframes = dev->period_frames;
 	struct list_item * blist;
 
 	trace_mixer("Mix");
@@ -207,20 +237,22 @@ static int mixer_copy(struct comp_dev *dev)
 	sink = list_first_item(&dev->bsink_list, struct comp_buffer, source_list);
 
 	for(i = 0; i < num_mix_sources; i++) {
-		if (sources[i]->avail < cframes * sources[i]->params.pcm->frame_size)
-			cframes = sources[i]->avail /sources[i]->params.pcm->frame_size;
+		if (sources[i]->avail < cframes * sources[i]->frame_size) {
+			comp_buffer_xrun(sources[i], BUFFER_XRUN_UNDERRUN);
+			cframes = sources[i]->avail /sources[i]->frame_size;
+		}
+	}
+	if (sink->free < cframes * sink->frame_size) {
+		comp_buffer_xrun(sink, BUFFER_XRUN_OVERRUN);
+		cframes = sink->free /sink->frame_size;
 	}
-	if (sink->free < cframes * sink->params.pcm->frame_size)
-		cframes = sink->free /sink->params.pcm->frame_size;
 
 	if (num_mix_sources == 0)
 		cframes = 0;
 
 	/* no frames to mix */
-	if (cframes == 0) {
-		trace_value(cframes);
+	if (cframes == 0)
 		return 0;
-	}
 
 	/* mix streams */
 	md->mix_func(dev, sink, sources, i, cframes);
@@ -269,15 +301,19 @@ static int mixer_prepare(struct comp_dev *dev)
 {
 	struct mixer_data *md = comp_get_drvdata(dev);
 	struct list_item * blist;
-	struct comp_buffer *source;
+	struct comp_buffer *source, *sink;
 	int downstream = 0;
 
 	trace_mixer("MPp");
 
 	if (dev->state != COMP_STATE_RUNNING) {
-		md->mix_func = mix_n;
+		sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+			source_list);
+		if (sink->frame_fmt == SOF_IPC_FRAME_S16_LE)
+			md->mix_func = mix_n_s16;
+		else
+			md->mix_func = mix_n;
 		dev->state = COMP_STATE_PREPARE;
-		//dev->preload = PLAT_INT_PERIODS;
 	}
 
 	/* check each mixer source state */
@@ -297,20 +333,36 @@ static int mixer_prepare(struct comp_dev *dev)
 
 static int mixer_preload(struct comp_dev *dev)
 {
-	//int i;
+	struct comp_buffer *sink, *source;
+	struct list_item *blist;
+	int ret;
 
 	if (dev->state != COMP_STATE_PREPARE)
 		return 1;
 
-	/* preload and mix periods if inactive */
-	//for (i = 0; i < dev->preload; i++)
-	//	mixer_copy(dev);
+	/* preload and mix a period if inactive and every source has one */
+	list_for_item(blist, &dev->bsource_list) {
+		source = container_of(blist, struct comp_buffer, sink_list);
+		if (source->source->state == dev->state &&
+			source->avail < dev->period_frames * source->frame_size)
+			return 0;
+	}
+
+	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+	if (sink->free < dev->period_frames * sink->frame_size)
+		return 0;
 
-	return 0;
+	ret = mixer_copy(dev);
+	return ret < 0 ? ret : 0;
 }
 
 struct comp_driver comp_mixer = {
 	.type	= SOF_COMP_MIXER,
+	.formats_in	= COMP_FMT(SOF_IPC_FRAME_S16_LE) |
+		COMP_FMT(SOF_IPC_FRAME_S24_4LE) | COMP_FMT(SOF_IPC_FRAME_S32_LE),
+	.formats_out	= COMP_FMT(SOF_IPC_FRAME_S16_LE) |
+		COMP_FMT(SOF_IPC_FRAME_S24_4LE) | COMP_FMT(SOF_IPC_FRAME_S32_LE),
 	.ops	= {
 		.new		= mixer_new,
 		.free		= mixer_free,
@@ -39,15 +39,35 @@
 #include <reef/alloc.h>
 #include <reef/debug.h>
 #include <reef/ipc.h>
+#include <reef/clock.h>
+#include <reef/work.h>
 #include <platform/timer.h>
 #include <platform/platform.h>
+#include <platform/clk.h>
 #include <reef/audio/component.h>
 #include <reef/audio/pipeline.h>
 
+/* scratch buffer memory of one pipeline - freed with its last buffer */
+struct scratch_pool {
+	void *addr;
+	uint32_t size;
+	uint32_t users;		/* buffers placed in pool */
+};
+
 struct pipeline_data {
 	spinlock_t lock;
 };
 
+/* scratch buffer placement */
+struct buffer_plan {
+	struct comp_buffer *buffer;
+	struct comp_buffer *head;	/* first buffer of chain */
+	uint32_t start;			/* first copy in chain buffer is live */
+	uint32_t end;			/* last copy in chain buffer is live */
+	uint32_t offset;		/* offset in pipeline scratch area */
+	uint32_t size;
+};
+
 /* generic operation data used by op graph walk */
 struct op_data {
 	int op;
@@ -59,6 +79,7 @@ struct op_data {
 
 static struct pipeline_data *pipe_data;
 static void pipeline_task(void *arg);
+static uint32_t pipeline_timer(void *data, uint32_t udelay);
 
 /* create new pipeline - returns pipeline id or negative error */
 struct pipeline *pipeline_new(struct sof_ipc_pipe_new *pipe_desc)
@@ -76,10 +97,33 @@ struct pipeline *pipeline_new(struct sof_ipc_pipe_new *pipe_desc)
 
 	/* init pipeline */
 	task_init(&p->pipe_task, pipeline_task, p);
+	work_init(&p->sched_work, pipeline_timer, p, WORK_SYNC);
 	list_init(&p->comp_list);
 	list_init(&p->buffer_list);
+	list_init(&p->fifo_list);
 	spinlock_init(&p->lock);
 	memcpy(&p->ipc_pipe, pipe_desc, sizeof(*pipe_desc));
+	p->id = pipe_desc->pipeline_id;
+
+	/* period size and deadline are per pipeline, or platform default */
+	p->period_frames = pipe_desc->period_frames ?
+		pipe_desc->period_frames : PLAT_INT_PERIOD_FRAMES;
+	p->deadline = pipe_desc->deadline ?
+		pipe_desc->deadline : PLAT_DAI_SCHED;
+
+	/* map IPC priority 0 (low) .. 10 (max) onto task priority */
+	p->priority = pipe_desc->priority > SOF_IPC_PIPE_PRI_MAX ?
+		SOF_IPC_PIPE_PRI_MAX : pipe_desc->priority;
+	p->priority = TASK_PRI_LOW - p->priority *
+		(TASK_PRI_LOW - TASK_PRI_HIGH) / SOF_IPC_PIPE_PRI_MAX;
+
+	/* task level is needed before the task is first scheduled */
+	p->pipe_task.priority = p->priority;
+
+	/* DAI DMA IRQs can only be coalesced when timer scheduled */
+	p->dma_periods = 1;
+	if (pipeline_is_timer(p) && pipe_desc->dma_periods > 1)
+		p->dma_periods = pipe_desc->dma_periods;
 
 	return p;
 }
@@ -87,9 +131,24 @@ struct pipeline *pipeline_new(struct sof_ipc_pipe_new *pipe_desc)
 /* pipelines must be inactive */
 void pipeline_free(struct pipeline *p)
 {
+	struct list_item *blist, *tlist;
+
 	trace_pipe("PFr");
 
+	/* buffers are freed separately so just detach them */
+	list_for_item_safe(blist, tlist, &p->buffer_list) {
+		list_item_del(blist);
+		list_init(blist);
+	}
+
+	list_for_item_safe(blist, tlist, &p->fifo_list) {
+		list_item_del(blist);
+		list_init(blist);
+	}
+
 	/* remove from any scheduling */
+	work_cancel_default(&p->sched_work);
+	schedule_task_release(&p->pipe_task);
 
 	/* now free the pipeline */
 //	list_item_del(&p->list);
@@ -122,6 +181,15 @@ int pipeline_pipe_connect(struct pipeline *psource, struct pipeline *psink,
 	/* connect the components */
 	buffer->connected = 1;
 
+	/* source pipeline negotiates the buffer format */
+	list_item_append(&buffer->pipe_list, &psource->buffer_list);
+
+	/* FIFO pipelines read from it as a FIFO */
+	if (pipeline_is_fifo(psource) || pipeline_is_fifo(psink)) {
+		buffer->fifo = 1;
+		list_item_append(&buffer->fifo_list, &psink->fifo_list);
+	}
+
 	spin_unlock_irq(&psource->lock, flags);
 	return 0;
 }
@@ -149,6 +217,7 @@ int pipeline_comp_connect(struct pipeline *p, struct comp_dev *source,
 	/* connect the components */
 	spin_lock(&p->lock);
 	buffer->connected = 1;
+	list_item_append(&buffer->pipe_list, &p->buffer_list);
 	spin_unlock(&p->lock);
 
 	return 0;
@@ -231,6 +300,121 @@ static int pipeline_depth(struct comp_dev *comp, int current)
 	return current;
 }
 
+/* preload bytes still missing in buffers feeding endpoints or other pipelines */
+static uint32_t pipeline_preload_missing(struct pipeline *p)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	uint32_t need, missing = 0;
+
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+
+		if (!buffer->connected || (!buffer->sink->is_endpoint &&
+			buffer->sink->pipeline == p))
+			continue;
+
+		need = buffer->ipc_buffer.preload_count * p->period_frames *
+			buffer->frame_size;
+		if (buffer->avail < need)
+			missing += need - buffer->avail;
+	}
+
+	return missing;
+}
+
+/*
+ * Preload playback buffers before the DAI starts. Host periods are moved
+ * downstream until buffers at the pipeline end hold their preload periods,
+ * leaving buffers inside the pipeline empty. Then the host buffer is filled
+ * to its own preload periods. Preloading stops early if the host runs out
+ * of data. Pipeline lock held by caller.
+ */
+static int pipeline_preload(struct pipeline *p, struct comp_dev *host)
+{
+	struct comp_buffer *buffer;
+	uint32_t missing, last, need;
+	int depth, ret;
+
+	trace_pipe("PPl");
+
+	depth = pipeline_depth(host, 0);
+
+	missing = pipeline_preload_missing(p);
+	while (missing) {
+		ret = component_preload(host, host, 0, depth);
+		if (ret < 0)
+			return ret;
+
+		last = missing;
+		missing = pipeline_preload_missing(p);
+		if (missing >= last)
+			break;
+	}
+
+	buffer = list_first_item(&host->bsink_list, struct comp_buffer,
+		source_list);
+	need = buffer->ipc_buffer.preload_count * p->period_frames *
+		buffer->frame_size;
+
+	while (buffer->avail < need) {
+		last = buffer->avail;
+		ret = comp_preload(host);
+		if (ret < 0)
+			return ret;
+		if (buffer->avail <= last)
+			break;
+	}
+
+	if (missing)
+		trace_error1(TRACE_CLASS_PIPE, "ePl", missing);
+
+	return 0;
+}
+
+/* DAI has started so first sample is on the wire */
+void pipeline_first_sample(struct pipeline *p)
+{
+	uint32_t ticks = platform_timer_get(NULL) - p->trigger_time;
+
+	p->start_latency = ticks / clock_us_to_ticks(PLATFORM_SCHED_CLOCK, 1);
+	trace_event2(TRACE_CLASS_PIPE, "PSl", p->id, p->start_latency);
+}
+
+/* frame size on the stream side of a component - sink buffer if any */
+static uint32_t comp_frame_size(struct comp_dev *dev,
+	struct stream_params *params)
+{
+	struct comp_buffer *buffer = NULL;
+
+	if (!list_is_empty(&dev->bsink_list))
+		buffer = list_first_item(&dev->bsink_list, struct comp_buffer,
+			source_list);
+	else if (!list_is_empty(&dev->bsource_list))
+		buffer = list_first_item(&dev->bsource_list, struct comp_buffer,
+			sink_list);
+
+	/* buffer format not negotiated, so use stream format */
+	if (buffer == NULL || buffer->frame_size == 0)
+		return params->pcm->frame_size;
+
+	return buffer->frame_size;
+}
+
+/* components process the period size of their pipeline */
+static void comp_period_set(struct pipeline *p, struct comp_dev *dev,
+	struct stream_params *params)
+{
+	dev->period_frames = p->period_frames;
+
+	/* compressed streams have variable period bytes */
+	if (params->type == STREAM_TYPE_PCM)
+		dev->period_bytes = p->period_frames *
+			comp_frame_size(dev, params);
+	else
+		dev->period_bytes = 0;
+}
+
 /* call op on all downstream components - locks held by caller */
 static int component_op_downstream(struct op_data *op_data,
 	struct comp_dev *start, struct comp_dev *current, int op_start)
@@ -240,8 +424,7 @@ static int component_op_downstream(struct op_data *op_data,
 
 // TODO: params must go on stack for correct downstreaming
 
-	trace_pipe("CO-");
-	trace_value(current->comp.id);
+	trace_event1(TRACE_CLASS_PIPE, "CO-", current->comp.id);
 
 	/* do we need to perform cmd to start component ? */
 	if (op_start && start == current)
@@ -251,6 +434,8 @@ static int component_op_downstream(struct op_data *op_data,
 	switch (op_data->op) {
 	case COMP_OPS_PARAMS:
 		/* send params to the component */
+		comp_period_set(current->pipeline, current,
+			op_data->params);
 		err = comp_params(current, op_data->params);
 		break;
 	case COMP_OPS_CMD:
@@ -267,8 +452,7 @@ static int component_op_downstream(struct op_data *op_data,
 		break;
 	case COMP_OPS_BUFFER: /* handled by other API call */
 	default:
-		trace_pipe_error("eOi");
-		trace_value(op_data->op);
+		trace_error1(TRACE_CLASS_PIPE, "eOi", op_data->op);
 		return -EINVAL;
 	}
 
@@ -295,11 +479,18 @@ downstream:
 		if (!buffer->connected)
 			continue;
 
-		/* dont go downstream if this sink is from another pipeline */
-		if (buffer->sink->pipeline != start->pipeline)
-			continue;
-
-		err = component_op_downstream(op_data, start, buffer->sink, op_start);
+		/* only FIFOs lead into another pipeline, and under its lock */
+		if (buffer->sink->pipeline != current->pipeline) {
+			if (!buffer->fifo)
+				continue;
+
+			spin_lock(&buffer->sink->pipeline->lock);
+			err = component_op_downstream(op_data, start,
+				buffer->sink, op_start);
+			spin_unlock(&buffer->sink->pipeline->lock);
+		} else
+			err = component_op_downstream(op_data, start,
+				buffer->sink, op_start);
 		if (err < 0)
 			break;
 	}
@@ -314,8 +505,7 @@ static int component_op_upstream(struct op_data *op_data,
 	struct list_item *clist;
 	int err = 0;
 
-	trace_pipe("CO+");
-	trace_value(current->comp.id);
+	trace_event1(TRACE_CLASS_PIPE, "CO+", current->comp.id);
 
 	/* do we need to perform cmd to start component ? */
 	if (op_start && start == current)
@@ -325,6 +515,8 @@ static int component_op_upstream(struct op_data *op_data,
 	switch (op_data->op) {
 	case COMP_OPS_PARAMS:
 		/* send params to the component */
+		comp_period_set(current->pipeline, current,
+			op_data->params);
 		err = comp_params(current, op_data->params);
 		break;
 	case COMP_OPS_CMD:
@@ -341,8 +533,7 @@ static int component_op_upstream(struct op_data *op_data,
 		break;
 	case COMP_OPS_BUFFER: /* handled by other API call */
 	default:
-		trace_pipe_error("eOi");
-		trace_value(op_data->op);
+		trace_error1(TRACE_CLASS_PIPE, "eOi", op_data->op);
 		return -EINVAL;
 	}
 
@@ -366,11 +557,18 @@ upstream:
 		if (!buffer->connected)
 			continue;
 
-		/* dont go upstream if this source is from another pipeline */
-		if (buffer->source->pipeline != start->pipeline)
-			continue;
-
-		err = component_op_upstream(op_data, start, buffer->source, op_start);
+		/* only FIFOs lead into another pipeline, and under its lock */
+		if (buffer->source->pipeline != current->pipeline) {
+			if (!buffer->fifo)
+				continue;
+
+			spin_lock(&buffer->source->pipeline->lock);
+			err = component_op_upstream(op_data, start,
+				buffer->source, op_start);
+			spin_unlock(&buffer->source->pipeline->lock);
+		} else
+			err = component_op_upstream(op_data, start,
+				buffer->source, op_start);
 		if (err < 0)
 			break;
 	}
@@ -378,42 +576,826 @@ upstream:
 	return err;
 }
 
+/*
+ * Format negotiation. Every buffer in the pipeline starts with the formats
+ * both of its components support and the host buffer is restricted to the
+ * host stream format. Components that cannot convert need the same format on
+ * all their buffers, so candidates are intersected across them until nothing
+ * changes. Each buffer then gets its cheapest candidate, i.e. the host format
+ * if possible, so conversion only happens in converting components and only
+ * where the formats either side of them differ. Channels only change at
+ * components with sink_channels set.
+ */
+
+/*
+ * cheapest format order - smallest container first. Packed 24 bit is only
+ * used where it is the host format as it is costly to process.
+ */
+static const enum sof_ipc_frame fmt_order[] = {
+	SOF_IPC_FRAME_S16_LE,
+	SOF_IPC_FRAME_S24_4LE,
+	SOF_IPC_FRAME_S32_LE,
+};
+
+static inline uint32_t fmt_bits(enum sof_ipc_frame fmt)
+{
+	switch (fmt) {
+	case SOF_IPC_FRAME_S16_LE:
+		return 16;
+	case SOF_IPC_FRAME_S24_3LE:
+	case SOF_IPC_FRAME_S24_4LE:
+		return 24;
+	case SOF_IPC_FRAME_S32_LE:
+	default:
+		return 32;
+	}
+}
+
+static inline uint32_t comp_fmt_in(struct comp_dev *dev)
+{
+	return dev->drv->formats_in ? dev->drv->formats_in : COMP_FMT_ANY;
+}
+
+static inline uint32_t comp_fmt_out(struct comp_dev *dev)
+{
+	return dev->drv->formats_out ? dev->drv->formats_out : COMP_FMT_ANY;
+}
+
+/* candidate formats of buffer, fixed if negotiated by another pipeline */
+static uint32_t buffer_fmt_mask(struct pipeline *p,
+	struct comp_buffer *buffer)
+{
+	if (buffer->source->pipeline == p)
+		return buffer->fmt_mask;
+
+	if (buffer->frame_size)
+		return COMP_FMT(buffer->frame_fmt);
+
+	return COMP_FMT_ANY;
+}
+
+/* formats a component can use on all of its buffers */
+static uint32_t comp_fmt_common(struct pipeline *p, struct comp_dev *dev)
+{
+	struct list_item *clist;
+	struct comp_buffer *buffer;
+	uint32_t mask = COMP_FMT_ANY;
+
+	if (dev->drv->flags & COMP_DRV_FMT_CONVERT)
+		return mask;
+
+	list_for_item(clist, &dev->bsource_list) {
+		buffer = container_of(clist, struct comp_buffer, sink_list);
+		if (buffer->connected)
+			mask &= buffer_fmt_mask(p, buffer);
+	}
+
+	list_for_item(clist, &dev->bsink_list) {
+		buffer = container_of(clist, struct comp_buffer, source_list);
+		if (buffer->connected)
+			mask &= buffer_fmt_mask(p, buffer);
+	}
+
+	return mask;
+}
+
+/* host format if possible, else smallest container that keeps precision */
+static enum sof_ipc_frame fmt_cheapest(uint32_t mask,
+	enum sof_ipc_frame stream_fmt)
+{
+	enum sof_ipc_frame fmt = stream_fmt;
+	int i;
+
+	if (mask & COMP_FMT(stream_fmt))
+		return stream_fmt;
+
+	for (i = 0; i < ARRAY_SIZE(fmt_order); i++) {
+		if (!(mask & COMP_FMT(fmt_order[i])))
+			continue;
+
+		/* widest so far if nothing keeps precision */
+		fmt = fmt_order[i];
+		if (fmt_bits(fmt) >= fmt_bits(stream_fmt))
+			break;
+	}
+
+	return fmt;
+}
+
+/* channels produced by component - only converters change channels */
+static uint32_t comp_channels_out(struct comp_dev *dev, uint32_t channels)
+{
+	struct list_item *clist;
+	struct comp_buffer *buffer;
+
+	if (dev->sink_channels)
+		return dev->sink_channels;
+
+	list_for_item(clist, &dev->bsource_list) {
+		buffer = container_of(clist, struct comp_buffer, sink_list);
+		if (buffer->connected && buffer->channels)
+			return buffer->channels;
+	}
+
+	return channels;
+}
+
+/* negotiate buffer formats - pipeline lock held by caller */
+static int pipeline_format_negotiate(struct pipeline *p,
+	struct comp_dev *host, struct stream_params *params)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	uint32_t mask, channels;
+	int changed;
+
+	/* compressed streams are not converted */
+	if (params->type != STREAM_TYPE_PCM)
+		return 0;
+
+	/* start with formats supported by both buffer components */
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+
+		buffer->fmt_mask = comp_fmt_out(buffer->source) &
+			comp_fmt_in(buffer->sink);
+
+		/* host side of the stream is always in host format */
+		if (buffer->source == host || buffer->sink == host)
+			buffer->fmt_mask &= COMP_FMT(params->pcm->frame_fmt);
+	}
+
+	/* channels flow downstream from the stream until a converter */
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+		buffer->channels = 0;
+	}
+
+	do {
+		changed = 0;
+
+		list_for_item(blist, &p->buffer_list) {
+			buffer = container_of(blist, struct comp_buffer,
+				pipe_list);
+
+			channels = comp_channels_out(buffer->source,
+				params->pcm->channels);
+
+			if (channels != buffer->channels) {
+				buffer->channels = channels;
+				changed = 1;
+			}
+		}
+	} while (changed);
+
+	/* non converting components have one format on all buffers */
+	do {
+		changed = 0;
+
+		list_for_item(blist, &p->buffer_list) {
+			buffer = container_of(blist, struct comp_buffer,
+				pipe_list);
+
+			mask = buffer->fmt_mask &
+				comp_fmt_common(p, buffer->source) &
+				comp_fmt_common(p, buffer->sink);
+
+			if (mask != buffer->fmt_mask) {
+				buffer->fmt_mask = mask;
+				changed = 1;
+			}
+		}
+	} while (changed);
+
+	/* pick the cheapest candidate */
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+
+		if (buffer->fmt_mask == 0) {
+			trace_pipe_error("eFn");
+			trace_value(buffer->ipc_buffer.comp.id);
+			return -EINVAL;
+		}
+
+		buffer->frame_fmt = fmt_cheapest(buffer->fmt_mask,
+			params->pcm->frame_fmt);
+		buffer->frame_size = comp_sample_bytes(buffer->frame_fmt) *
+			buffer->channels;
+
+		/* copies wrap at end_addr on frame boundaries */
+		if (buffer->frame_size == 0 ||
+			buffer->ipc_buffer.size % buffer->frame_size) {
+			trace_error2(TRACE_CLASS_PIPE, "eFa",
+				buffer->ipc_buffer.comp.id,
+				buffer->ipc_buffer.size);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * In place processing. A component with COMP_DRV_INPLACE and one source and
+ * one sink buffer of the same format, channels and size has its sink buffer
+ * aliased to its source buffer, so it processes the period in place. The sink
+ * buffer memory is released and the period is not copied to a second buffer.
+ * Buffers next to endpoints are not aliased as their DMA runs independently
+ * of the pipeline, nor are chains of aliases.
+ */
+
+/* get single source buffer if component can process in place */
+static struct comp_buffer *comp_inplace_source(struct pipeline *p,
+	struct comp_dev *dev, struct comp_buffer *sink)
+{
+	struct comp_buffer *source;
+
+	/* fused runs dont use their buffers */
+	if (!(dev->drv->flags & COMP_DRV_INPLACE) || dev->fuse_head)
+		return NULL;
+
+	/* one source and one sink buffer only */
+	if (list_is_empty(&dev->bsource_list) ||
+		!list_item_is_last(&sink->source_list, &dev->bsink_list) ||
+		dev->bsink_list.next != &sink->source_list)
+		return NULL;
+
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	if (!list_item_is_last(&source->sink_list, &dev->bsource_list))
+		return NULL;
+
+	/* both buffers owned by this pipeline and not already aliased */
+	if (source->source->pipeline != p || !source->connected ||
+		!sink->connected || source->alias || source->alias_of)
+		return NULL;
+
+	/* FIFOs are read and written by pipelines at different times */
+	if (source->fifo || sink->fifo)
+		return NULL;
+
+	/* DMA endpoints run independently of the pipeline */
+	if (source->source->is_endpoint || sink->sink->is_endpoint)
+		return NULL;
+
+	/* same data layout and ring size */
+	if (source->frame_fmt != sink->frame_fmt ||
+		source->channels != sink->channels ||
+		source->ipc_buffer.size != sink->ipc_buffer.size)
+		return NULL;
+
+	return source;
+}
+
+/* give aliased buffers their own memory back - pipeline lock held */
+static int pipeline_inplace_release(struct pipeline *p)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	int ret;
+
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+
+		if (buffer->alias_of == NULL)
+			continue;
+
+		ret = buffer_unalias(buffer);
+		if (ret < 0)
+			return ret;
+	}
+
+	p->inplace_bytes = 0;
+	p->inplace_period_bytes = 0;
+	return 0;
+}
+
+/* alias buffers of in place components - pipeline lock held */
+static void pipeline_inplace_alias(struct pipeline *p)
+{
+	struct list_item *blist;
+	struct comp_buffer *sink, *source;
+
+	list_for_item(blist, &p->buffer_list) {
+		sink = container_of(blist, struct comp_buffer, pipe_list);
+
+		source = comp_inplace_source(p, sink->source, sink);
+		if (source == NULL)
+			continue;
+
+		buffer_alias(source, sink);
+
+		/* scratch memory stays reserved in the pool */
+		if (sink->scratch_addr == NULL)
+			p->inplace_bytes += sink->alloc_size;
+		p->inplace_period_bytes += p->period_frames * sink->frame_size;
+	}
+
+	if (p->inplace_bytes)
+		trace_event2(TRACE_CLASS_PIPE, "PIp", p->inplace_bytes,
+			p->inplace_period_bytes);
+}
+
+/*
+ * Buffer planning. Buffers that keep data across periods have their own
+ * memory - DMA buffers next to endpoints, preloaded buffers, buffers between
+ * pipelines and buffers of components like SRC that keep a backlog. All other
+ * buffers are scratch, written and completely read within one pipeline copy.
+ * Each pipeline places its scratch buffers in its own pool, as a buffer left
+ * holding data by a partial copy must not be overwritten by another pipeline.
+ * Components in a chain of single source and single sink components are
+ * copied in chain order, so scratch buffers of one chain that are not live
+ * together share memory.
+ */
+
+/* component has one source and one sink buffer */
+static inline int comp_is_chain(struct comp_dev *dev)
+{
+	return !list_is_empty(&dev->bsource_list) &&
+		dev->bsource_list.next == dev->bsource_list.prev &&
+		!list_is_empty(&dev->bsink_list) &&
+		dev->bsink_list.next == dev->bsink_list.prev;
+}
+
+/* is buffer only live within one copy of this pipeline */
+static int buffer_is_scratch(struct pipeline *p, struct comp_buffer *buffer)
+{
+	if (!buffer->connected || buffer->scratch_addr)
+		return 0;
+
+	/* pipelines are copied at different times */
+	if (buffer->source->pipeline != p || buffer->sink->pipeline != p)
+		return 0;
+
+	/* preloaded data is kept until the stream starts */
+	if (buffer->ipc_buffer.preload_count)
+		return 0;
+
+	/* endpoints are not flagged as their DMA runs between copies */
+	return (buffer->source->drv->flags & COMP_DRV_PERIOD) &&
+		(buffer->sink->drv->flags & COMP_DRV_PERIOD);
+}
+
+/* get first buffer of chain and position of buffer in chain */
+static struct comp_buffer *buffer_chain(struct pipeline *p,
+	struct comp_buffer *buffer, uint32_t *pos)
+{
+	struct comp_dev *dev = buffer->source;
+
+	*pos = 0;
+	while (dev->pipeline == p && comp_is_chain(dev)) {
+		buffer = list_first_item(&dev->bsource_list,
+			struct comp_buffer, sink_list);
+		dev = buffer->source;
+		(*pos)++;
+	}
+
+	return buffer;
+}
+
+/* can buffers be live at the same time */
+static inline int plan_overlap(struct buffer_plan *a, struct buffer_plan *b)
+{
+	/* chains can be copied in any order */
+	if (a->head != b->head)
+		return 1;
+
+	return a->start <= b->end && b->start <= a->end;
+}
+
+/* lowest offset not used by placed buffers that are live with buffer */
+static uint32_t plan_offset(struct buffer_plan *plan, int placed,
+	struct buffer_plan *b)
+{
+	uint32_t offset = 0;
+	int i;
+
+	for (i = 0; i < placed; i++) {
+		if (!plan_overlap(&plan[i], b))
+			continue;
+
+		/* memory in use, try again after it */
+		if (offset < plan[i].offset + plan[i].size &&
+			plan[i].offset < offset + b->size) {
+			offset = plan[i].offset + plan[i].size;
+			i = -1;
+		}
+	}
+
+	return offset;
+}
+
+/* new scratch pool of size bytes */
+static struct scratch_pool *scratch_pool_new(uint32_t size)
+{
+	struct scratch_pool *pool;
+
+	pool = rzalloc(RZONE_RUNTIME, RFLAGS_NONE, sizeof(*pool));
+	if (pool == NULL)
+		return NULL;
+
+	pool->addr = rballoc(RZONE_RUNTIME, RFLAGS_NONE, size);
+	if (pool->addr == NULL) {
+		rfree(pool);
+		return NULL;
+	}
+
+	bzero(pool->addr, size);
+	pool->size = size;
+	return pool;
+}
+
+/* buffer no longer uses scratch pool - pool is freed with last buffer */
+void pipeline_scratch_put(struct comp_buffer *buffer)
+{
+	struct scratch_pool *pool = buffer->scratch_pool;
+
+	/* buffers are freed by IPC so only one at a time */
+	buffer->scratch_pool = NULL;
+	if (--pool->users)
+		return;
+
+	rbfree(pool->addr);
+	rfree(pool);
+}
+
+/* place scratch buffers in scratch pool - pipeline lock held */
+static int pipeline_buffer_plan(struct pipeline *p)
+{
+	struct scratch_pool *pool;
+	struct buffer_plan *plan;
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	uint32_t size = 0, bytes = 0;
+	int count = 0, i = 0, ret = 0;
+
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+		if (buffer_is_scratch(p, buffer))
+			count++;
+	}
+
+	if (count == 0)
+		return 0;
+
+	plan = rzalloc(RZONE_RUNTIME, RFLAGS_NONE, sizeof(*plan) * count);
+	if (plan == NULL)
+		return -ENOMEM;
+
+	/* place buffers in pipeline scratch area */
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+		if (!buffer_is_scratch(p, buffer))
+			continue;
+
+		plan[i].buffer = buffer;
+		plan[i].head = buffer_chain(p, buffer, &plan[i].start);
+		plan[i].end = plan[i].start + 1;
+
+		/* sink buffer of an in place sink can alias this buffer */
+		if ((buffer->sink->drv->flags & COMP_DRV_INPLACE) &&
+			comp_is_chain(buffer->sink))
+			plan[i].end++;
+
+		plan[i].size = (buffer->alloc_size + 3) & ~3;
+		plan[i].offset = plan_offset(plan, i, &plan[i]);
+
+		if (plan[i].offset + plan[i].size > size)
+			size = plan[i].offset + plan[i].size;
+		bytes += buffer->alloc_size;
+		i++;
+	}
+
+	pool = scratch_pool_new(size);
+	if (pool == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		buffer = plan[i].buffer;
+		buffer->scratch_pool = pool;
+		buffer_scratch_set(buffer, pool->addr + plan[i].offset);
+	}
+	pool->users = count;
+
+	p->scratch_bytes = bytes;
+	p->scratch_size = size;
+	trace_event2(TRACE_CLASS_PIPE, "PSp", bytes, size);
+
+out:
+	rfree(plan);
+	return ret;
+}
+
+/* buffers outside scratch pool need own memory - pipeline lock held */
+static int pipeline_buffer_alloc(struct pipeline *p)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	int ret;
+
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+
+		ret = buffer_alloc(buffer);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* pipeline construction is complete so plan its buffer memory */
+int pipeline_complete(struct pipeline *p)
+{
+	int ret;
+
+	trace_pipe("PCp");
+
+	spin_lock(&p->lock);
+
+	/* buffers are only planned once */
+	if (!p->complete) {
+		p->complete = 1;
+
+		/* buffers keep their own memory if planning fails */
+		ret = pipeline_buffer_plan(p);
+		if (ret < 0)
+			trace_pipe_error("ePp");
+	}
+
+	ret = pipeline_buffer_alloc(p);
+
+	spin_unlock(&p->lock);
+	return ret;
+}
+
+/*
+ * Fused execution. A run of single source and sink components with a process
+ * op is copied by its first component a chunk at a time, each chunk passing
+ * through all components in a small scratch that stays in cache. Buffers
+ * inside the run are not touched, so the period is read and written once.
+ */
+
+/* fused run scratch - one pair per task level as levels preempt each other */
+static int32_t __hot_bss fuse_scratch[TASK_LEVELS][2]
+	[PIPELINE_FUSE_FRAMES * PIPELINE_FUSE_CHANNELS];
+
+/* can component be part of a fused run */
+static inline int comp_is_fusable(struct pipeline *p, struct comp_dev *dev)
+{
+	return dev->pipeline == p && dev->drv->ops.process != NULL &&
+		comp_is_chain(dev);
+}
+
+/* next component in fused run or NULL if run ends at dev */
+static struct comp_dev *comp_fuse_next(struct pipeline *p,
+	struct comp_dev *dev)
+{
+	struct comp_buffer *buffer;
+
+	if (!comp_is_fusable(p, dev))
+		return NULL;
+
+	buffer = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+
+	/* buffer is replaced by scratch so must not hold data of its own */
+	if (!buffer->connected || buffer->ipc_buffer.preload_count ||
+		buffer->frame_size > PIPELINE_FUSE_CHANNELS * sizeof(int32_t))
+		return NULL;
+
+	if (!comp_is_fusable(p, buffer->sink))
+		return NULL;
+
+	return buffer->sink;
+}
+
+/* find fused runs after formats are negotiated - pipeline lock held */
+static void pipeline_fuse(struct pipeline *p)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	struct comp_dev *dev, *next;
+	int count;
+
+	/* runs depend on negotiated formats so start again */
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+		if (buffer->source->pipeline == p) {
+			buffer->source->fuse_head = NULL;
+			buffer->source->fuse_tail = NULL;
+		}
+		if (buffer->sink->pipeline == p) {
+			buffer->sink->fuse_head = NULL;
+			buffer->sink->fuse_tail = NULL;
+		}
+	}
+
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+		dev = buffer->sink;
+
+		/* runs start after a component that can't fuse into dev */
+		if (!comp_is_fusable(p, dev) ||
+			comp_fuse_next(p, buffer->source) == dev)
+			continue;
+
+		/* one component gains nothing */
+		if (comp_fuse_next(p, dev) == NULL)
+			continue;
+
+		count = 0;
+		for (next = dev; next != NULL; next = comp_fuse_next(p, next)) {
+			next->fuse_head = dev;
+			dev->fuse_tail = next;
+			count++;
+		}
+
+		trace_event2(TRACE_CLASS_PIPE, "PFu", dev->comp.id, count);
+	}
+}
+
+/* copy fused run a chunk at a time - called for run head */
+static int pipeline_fuse_copy(struct comp_dev *head)
+{
+	struct comp_buffer *source, *sink, *buffer;
+	struct comp_dev *dev;
+	int32_t (*scratch)[PIPELINE_FUSE_FRAMES * PIPELINE_FUSE_CHANNELS];
+	uint32_t cframes = head->period_frames, frames, n, limit;
+	void *src, *dst;
+	int i = 0;
+
+	source = list_first_item(&head->bsource_list, struct comp_buffer,
+		sink_list);
+	sink = list_first_item(&head->fuse_tail->bsink_list,
+		struct comp_buffer, source_list);
+	scratch = fuse_scratch[task_get_level(&head->pipeline->pipe_task)];
+
+	/* check for underrun and overrun */
+	if (source->avail < cframes * source->frame_size) {
+		comp_buffer_xrun(source, BUFFER_XRUN_UNDERRUN);
+		cframes = source->avail / source->frame_size;
+	}
+	if (sink->free < cframes * sink->frame_size) {
+		comp_buffer_xrun(sink, BUFFER_XRUN_OVERRUN);
+		cframes = sink->free / sink->frame_size;
+	}
+
+	/* start of period */
+	for (dev = head; ; dev = buffer->sink) {
+		dev->drv->ops.process(dev, NULL, NULL, 0);
+		if (dev == head->fuse_tail)
+			break;
+		buffer = list_first_item(&dev->bsink_list, struct comp_buffer,
+			source_list);
+	}
+
+	/* chunks end at buffer wrap */
+	for (frames = 0; frames < cframes; frames += n) {
+		n = cframes - frames;
+		if (n > PIPELINE_FUSE_FRAMES)
+			n = PIPELINE_FUSE_FRAMES;
+
+		limit = (source->end_addr - source->r_ptr) / source->frame_size;
+		if (n > limit)
+			n = limit;
+		limit = (sink->end_addr - sink->w_ptr) / sink->frame_size;
+		if (n > limit)
+			n = limit;
+
+		/* buffer sizes are frame aligned at format negotiation */
+		if (n == 0)
+			break;
+
+		/* pass chunk through run, ping ponging between scratch */
+		src = source->r_ptr;
+		for (dev = head; ; dev = buffer->sink) {
+			dst = dev == head->fuse_tail ? sink->w_ptr : scratch[i];
+			dev->drv->ops.process(dev, src, dst, n);
+			if (dev == head->fuse_tail)
+				break;
+
+			buffer = list_first_item(&dev->bsink_list,
+				struct comp_buffer, source_list);
+			src = dst;
+			i ^= 1;
+		}
+
+		source->r_ptr += n * source->frame_size;
+		if (source->r_ptr >= source->end_addr)
+			source->r_ptr = source->addr;
+		sink->w_ptr += n * sink->frame_size;
+		if (sink->w_ptr >= sink->end_addr)
+			sink->w_ptr = sink->addr;
+	}
+
+	/* calc new free and available */
+	comp_update_buffer_consume(source);
+	comp_update_buffer_produce(sink);
+
+	return frames;
+}
+
+/* components in a fused run are copied by the run head */
+static int pipeline_comp_copy(struct comp_dev *dev)
+{
+	if (dev->fuse_head == NULL)
+		return comp_copy(dev);
+
+	if (dev->fuse_head == dev)
+		return pipeline_fuse_copy(dev);
+
+	return 0;
+}
+
+/*
+ * Timer scheduling. The pipeline task is queued by the period timer rather
+ * than by the DAI DMA IRQ. The timer is realigned on every DAI DMA IRQ so it
+ * does not drift from the DAI clock.
+ */
+
+static void pipeline_timer_copy(struct pipeline *p)
+{
+	p->sched_last = platform_timer_get(NULL);
+
+	/* previous period has not completed yet */
+	if (pipeline_schedule_copy(p, p->sched_comp, p->deadline,
+		p->priority) < 0)
+		trace_pipe_error("eTo");
+}
+
+static uint32_t pipeline_timer(void *data, uint32_t udelay)
+{
+	struct pipeline *p = data;
+
+	tracev_pipe("PTm");
+
+	pipeline_timer_copy(p);
+
+	/* reschedule at the next period */
+	return p->sched_period;
+}
+
+/* start or stop period timer - pipeline lock held by caller */
+static int pipeline_timer_cmd(struct pipeline *p, struct comp_dev *host,
+	int cmd)
+{
+	switch (cmd) {
+	case COMP_CMD_START:
+	case COMP_CMD_RELEASE:
+		p->sched_comp = host;
+		p->sched_last = platform_timer_get(NULL);
+		work_schedule_default(&p->sched_work, p->sched_period);
+		break;
+	case COMP_CMD_STOP:
+	case COMP_CMD_PAUSE:
+		work_cancel_default(&p->sched_work);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/* DAI DMA IRQ is on a period boundary - realign timer to it */
+void pipeline_timer_align(struct pipeline *p)
+{
+	uint32_t current, half_period;
+
+	current = platform_timer_get(NULL);
+	half_period = clock_us_to_ticks(PLATFORM_SCHED_CLOCK,
+		p->sched_period) >> 1;
+
+	work_cancel_default(&p->sched_work);
+
+	/* timer has not run for this boundary yet so run it now */
+	if (current - p->sched_last > half_period)
+		pipeline_timer_copy(p);
+
+	work_schedule_default(&p->sched_work, p->sched_period);
+}
 
 /* prepare the pipeline for usage - preload host buffers here */
 int pipeline_prepare(struct pipeline *p, struct comp_dev *dev)
 {
 	struct sof_ipc_comp_host *host = (struct sof_ipc_comp_host *)&dev->comp;
 	struct op_data op_data;
-	int ret, depth, i;
+	int ret;
 
 	trace_pipe("Ppr");
 
 	op_data.p = p;
 	op_data.op = COMP_OPS_PREPARE;
 
+	/* playback buffers are preloaded at trigger start when host has data */
 	spin_lock(&p->lock);
-	if (host->direction == SOF_IPC_STREAM_PLAYBACK) {
-
-		/* first of all prepare the pipeline */
+	if (host->direction == SOF_IPC_STREAM_PLAYBACK)
 		ret = component_op_downstream(&op_data, dev, dev, 0);
-		if (ret < 0)
-			goto out;
-
-		/* then preload buffers - the buffers must be moved
-		 * downstream so that every component has full buffers for
-		 * trigger start */
-		depth = pipeline_depth(dev, 0);
-
-		for (i = depth; i > 0; i--) {
-			ret = component_preload(dev, dev, 0, i);
-			if (ret < 0)
-				break;
-		}
-	} else {
+	else
 		ret = component_op_upstream(&op_data, dev, dev, 0);
-	}
-
-out:
 	spin_unlock(&p->lock);
 	return ret;
 }
@@ -422,6 +1404,7 @@ out:
 int pipeline_cmd(struct pipeline *p, struct comp_dev *host, int cmd,
 	void *data)
 {
+	struct sof_ipc_comp_host *hc = (struct sof_ipc_comp_host *)&host->comp;
 	struct op_data op_data;
 	int ret;
 
@@ -434,6 +1417,25 @@ int pipeline_cmd(struct pipeline *p, struct comp_dev *host, int cmd,
 
 	spin_lock(&p->lock);
 
+	/* timer must have a period before components are started */
+	if (pipeline_is_timer(p) && p->sched_period == 0 &&
+		(cmd == COMP_CMD_START || cmd == COMP_CMD_RELEASE)) {
+		trace_pipe_error("eTp");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* playback starts from preloaded buffers */
+	if (cmd == COMP_CMD_START) {
+		p->trigger_time = platform_timer_get(NULL);
+
+		if (hc->direction == SOF_IPC_STREAM_PLAYBACK) {
+			ret = pipeline_preload(p, host);
+			if (ret < 0)
+				goto out;
+		}
+	}
+
 	/* send cmd upstream */
 	ret = component_op_upstream(&op_data, host, host, 1);
 	if (ret < 0)
@@ -441,16 +1443,184 @@ int pipeline_cmd(struct pipeline *p, struct comp_dev *host, int cmd,
 
 	/* send cmd downstream */
 	ret = component_op_downstream(&op_data, host, host, 0);
+	if (ret < 0)
+		goto out;
+
+	/* start or stop the period timer */
+	if (pipeline_is_timer(p))
+		ret = pipeline_timer_cmd(p, host, cmd);
 
 out:
 	spin_unlock(&p->lock);
 	return ret;
 }
 
+/*
+ * FIFO scheduling. Buffers connecting two pipelines are FIFOs and each side
+ * copies its own period at its own deadline, e.g. a 10ms host pipeline can
+ * feed a 1ms DAI pipeline. After every copy the pipeline checks the fill
+ * level of its FIFOs and schedules FIFO pipelines on the other side once a
+ * period of theirs fits (writers) or is available (readers). Params walk
+ * through FIFOs so pipelines without a host component are configured by the
+ * stream, each with its own period.
+ */
+
+static int pipeline_buffer_params(struct pipeline *p, struct comp_dev *host,
+	struct stream_params *params, uint32_t direction);
+
+/* component on the other side of FIFO from pipeline p */
+static struct comp_dev *fifo_peer(struct pipeline *p,
+	struct comp_buffer *buffer)
+{
+	return buffer->source->pipeline == p ? buffer->sink : buffer->source;
+}
+
+/* prepare pipeline buffer and set watermarks - pipeline lock held */
+static int pipeline_fifo_buffer_params(struct pipeline *p,
+	struct comp_buffer *buffer, struct stream_params *params,
+	uint32_t direction)
+{
+	struct comp_dev *peer = fifo_peer(p, buffer);
+	int ret = 0;
+
+	/* active pipelines keep their buffers */
+	if (peer->state != COMP_STATE_RUNNING &&
+		peer->state != COMP_STATE_PAUSED) {
+		spin_lock(&peer->pipeline->lock);
+		ret = pipeline_buffer_params(peer->pipeline, NULL, params,
+			direction);
+		spin_unlock(&peer->pipeline->lock);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* each side moves one of its own periods */
+	buffer->fifo_low = buffer->source->pipeline->period_frames *
+		buffer->frame_size;
+	buffer->fifo_high = buffer->sink->pipeline->period_frames *
+		buffer->frame_size;
+
+	if (buffer->ipc_buffer.size < buffer->fifo_low + buffer->fifo_high) {
+		trace_error1(TRACE_CLASS_PIPE, "eFf",
+			buffer->ipc_buffer.comp.id);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* prepare pipelines behind FIFOs in stream direction - pipeline lock held */
+static int pipeline_fifo_params(struct pipeline *p,
+	struct stream_params *params, uint32_t direction)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+	int ret;
+
+	if (direction == SOF_IPC_STREAM_PLAYBACK) {
+		/* FIFOs we write to are in our buffer list */
+		list_for_item(blist, &p->buffer_list) {
+			buffer = container_of(blist, struct comp_buffer,
+				pipe_list);
+
+			if (!buffer->fifo || buffer->source->pipeline != p)
+				continue;
+
+			ret = pipeline_fifo_buffer_params(p, buffer, params,
+				direction);
+			if (ret < 0)
+				return ret;
+		}
+	} else {
+		list_for_item(blist, &p->fifo_list) {
+			buffer = container_of(blist, struct comp_buffer,
+				fifo_list);
+
+			ret = pipeline_fifo_buffer_params(p, buffer, params,
+				direction);
+			if (ret < 0)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* schedule FIFO pipeline copy from dev unless already pending */
+static void pipeline_fifo_trigger(struct pipeline *p, struct comp_dev *dev)
+{
+	if (!pipeline_is_fifo(p) || dev->state != COMP_STATE_RUNNING)
+		return;
+
+	tracev_pipe("PFt");
+	pipeline_schedule_copy(p, dev, p->deadline, p->priority);
+}
+
+/* run pipelines on the other side of our FIFOs if they can copy */
+static void pipeline_fifo_notify(struct pipeline *p)
+{
+	struct list_item *blist;
+	struct comp_buffer *buffer;
+
+	/* readers of FIFOs we write to */
+	list_for_item(blist, &p->buffer_list) {
+		buffer = container_of(blist, struct comp_buffer, pipe_list);
+
+		if (buffer->fifo && buffer->source->pipeline == p &&
+			buffer->avail >= buffer->fifo_high)
+			pipeline_fifo_trigger(buffer->sink->pipeline,
+				buffer->sink);
+	}
+
+	/* writers of FIFOs we read from */
+	list_for_item(blist, &p->fifo_list) {
+		buffer = container_of(blist, struct comp_buffer, fifo_list);
+
+		if (buffer->free >= buffer->fifo_low)
+			pipeline_fifo_trigger(buffer->source->pipeline,
+				buffer->source);
+	}
+}
+
+/* prepare pipeline buffers for params - pipeline lock held by caller */
+static int pipeline_buffer_params(struct pipeline *p, struct comp_dev *host,
+	struct stream_params *params, uint32_t direction)
+{
+	int ret;
+
+	/* formats may have changed so start without aliases */
+	ret = pipeline_inplace_release(p);
+	if (ret < 0)
+		return ret;
+
+	/* buffer memory may not have been planned yet */
+	ret = pipeline_buffer_alloc(p);
+	if (ret < 0)
+		return ret;
+
+	/* buffer formats must be known before component params */
+	ret = pipeline_format_negotiate(p, host, params);
+	if (ret < 0)
+		return ret;
+
+	pipeline_fuse(p);
+	pipeline_inplace_alias(p);
+
+	/* timer period is the pipeline period at the stream rate */
+	p->sched_period = 0;
+	if (params->type == STREAM_TYPE_PCM && params->pcm->rate)
+		p->sched_period = (uint64_t)p->period_frames * 1000000 /
+			params->pcm->rate;
+
+	/* pipelines we feed or are fed by need their buffers too */
+	return pipeline_fifo_params(p, params, direction);
+}
+
 /* send pipeline component/endpoint params */
 int pipeline_params(struct pipeline *p, struct comp_dev *host,
 	struct stream_params *params)
 {
+	struct sof_ipc_comp_host *hc = (struct sof_ipc_comp_host *)&host->comp;
 	struct op_data op_data;
 	int ret;
 
@@ -462,6 +1632,10 @@ int pipeline_params(struct pipeline *p, struct comp_dev *host,
 
 	spin_lock(&p->lock);
 
+	ret = pipeline_buffer_params(p, host, params, hc->direction);
+	if (ret < 0)
+		goto out;
+
 	/* send cmd upstream */
 	ret = component_op_upstream(&op_data, host, host, 1);
 	if (ret < 0)
@@ -548,9 +1722,9 @@ copy:
 	/* we are at the upstream end point component so copy the buffers */
 	if (current == start) {
 		if (copy_start)
-			err = comp_copy(current);
+			err = pipeline_comp_copy(current);
 	} else
-		err = comp_copy(current);
+		err = pipeline_comp_copy(current);
 
 	/* return back downstream */
 //	trace_pipe("CD+");
@@ -578,9 +1752,9 @@ static int pipeline_copy_downstream(struct comp_dev *start,
 	/* component copy/process to downstream */
 	if (current == start) {
 		if (copy_start)
-			err = comp_copy(current);
+			err = pipeline_comp_copy(current);
 	} else
-		err = comp_copy(current);
+		err = pipeline_comp_copy(current);
 
 	/* stop going downstream if we reach an end point in this pipeline */
 	if (current != start && current->is_endpoint)
@@ -613,12 +1787,21 @@ static int pipeline_copy_downstream(struct comp_dev *start,
 	return err;
 }
 
-/* notify pipeline that this component requires buffers emptied/filled */
-void pipeline_schedule_copy(struct pipeline *p, struct comp_dev *dev,
-	uint32_t deadline, uint32_t priority)
+/*
+ * Notify pipeline that this component requires buffers emptied/filled.
+ * Returns -EBUSY if the previous copy is still queued or running.
+ */
+int pipeline_schedule_copy(struct pipeline *p, struct comp_dev *dev,
+	uint32_t deadline, int32_t priority)
 {
-	schedule_task(&p->pipe_task, deadline, priority, dev);
+	int ret;
+
+	ret = schedule_task(&p->pipe_task, deadline, priority, dev);
+	if (ret < 0)
+		return ret;
+
 	schedule();
+	return 0;
 }
 
 static void pipeline_task(void *arg)
@@ -626,13 +1809,22 @@ static void pipeline_task(void *arg)
 	struct pipeline *p = arg;
 	struct task *task = &p->pipe_task;
 	struct comp_dev *dev = task->sdata;
+	uint32_t start;
 
 	trace_pipe("PWs");
 
+	start = platform_timer_get(NULL);
+
 	/* copy datas from upstream source components to downstream sinks */
 	pipeline_copy_upstream(dev, dev, 1);
 	pipeline_copy_downstream(dev, dev, 0);
 
+	/* measure run time for admission control */
+	schedule_task_rtime(task, platform_timer_get(NULL) - start);
+
+	/* other side of our FIFOs may now have a period to copy */
+	pipeline_fifo_notify(p);
+
 	trace_pipe("PWe");
 }
 
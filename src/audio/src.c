@@ -125,7 +125,7 @@ static void fallback_s32(struct comp_dev *dev,
 	struct comp_data *cd = comp_get_drvdata(dev);
 	//int32_t *src = (int32_t*) source->r_ptr;
 	//int32_t *dest = (int32_t*) sink->w_ptr;
-	int nch = sink->params.pcm->channels;
+	int nch = sink->channels;
 	int blk_in = cd->src[0].blk_in;
 	int blk_out = cd->src[0].blk_out;
 
@@ -145,7 +145,7 @@ static void src_2s_s32_default(struct comp_dev *dev,
 	int blk_out = cd->src[0].blk_out;
 	int n_times1 = cd->src[0].stage1_times;
 	int n_times2 = cd->src[0].stage2_times;
-	int nch = sink->params.pcm->channels;
+	int nch = sink->channels;
 	int32_t *dest = (int32_t *) sink->w_ptr;
 	int32_t *src = (int32_t *) source->r_ptr;
 	struct src_stage_prm s1, s2;
@@ -218,7 +218,7 @@ static void src_1s_s32_default(struct comp_dev *dev,
 	int blk_in = cd->src[0].blk_in;
 	int blk_out = cd->src[0].blk_out;
 	int n_times = cd->src[0].stage1_times;
-	int nch = sink->params.pcm->channels;
+	int nch = sink->channels;
 	int32_t *dest = (int32_t *) sink->w_ptr;
 	int32_t *src = (int32_t *) source->r_ptr;
 	int n_read = 0;
@@ -329,7 +329,7 @@ static int src_params(struct comp_dev *dev, struct stream_params *params)
 
 	/* SRC supports only S32_LE PCM format */
 	if ((params->type != STREAM_TYPE_PCM)
-		|| (params->pcm->frame_fmt != SOF_IPC_FRAME_S32_LE))
+		|| (comp_sink_frame_fmt(dev) != SOF_IPC_FRAME_S32_LE))
 		return -EINVAL;
 
 	comp_buffer_sink_params(dev, params);
@@ -361,7 +361,7 @@ static int src_params(struct comp_dev *dev, struct stream_params *params)
 
 	/* Allocate needed memory for delay lines */
 	if (src_buffer_lengths(&need, source->params.pcm->rate,
-		sink->params.pcm->rate, source->params.pcm->channels) < 0)
+		sink->params.pcm->rate, source->channels) < 0)
 		return -EINVAL;
 
 	delay_lines_size = sizeof(int32_t) * need.total;
@@ -378,7 +378,7 @@ static int src_params(struct comp_dev *dev, struct stream_params *params)
 	buffer_start = cd->delay_lines + need.scratch;
 
 	/* Initize SRC for actual sample rate */
-	for (i = 0; i < source->params.pcm->channels; i++) {
+	for (i = 0; i < source->channels; i++) {
 		n = src_polyphase_init(&cd->src[i], source->params.pcm->rate,
 			sink->params.pcm->rate, buffer_start);
 		buffer_start += need.single_src;
@@ -500,18 +500,18 @@ static int src_copy(struct comp_dev *dev)
 	frames_sink = sink->params.pcm->period_count;
 	min_frames = src_polyphase_get_blk_in(&cd->src[0]);
 	if (frames_source > min_frames)
-		need_source = frames_source * source->params.pcm->frame_size;
+		need_source = frames_source * source->frame_size;
 	else {
 		frames_source = min_frames;
-		need_source = min_frames * source->params.pcm->frame_size;
+		need_source = min_frames * source->frame_size;
 	}
 
 	min_frames = src_polyphase_get_blk_out(&cd->src[0]);
 	if (frames_sink > min_frames)
-		need_sink = frames_sink * sink->params.pcm->frame_size;
+		need_sink = frames_sink * sink->frame_size;
 	else {
 		frames_sink = min_frames;
-		need_sink = min_frames * sink->params.pcm->frame_size;
+		need_sink = min_frames * sink->frame_size;
 	}
 
 	/* Run as many times as buffers allow */
@@ -539,26 +539,20 @@ static int src_prepare(struct comp_dev *dev)
 	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
 		source_list);
 
-	trace_value(source->params.pcm->channels);
+	trace_value(source->channels);
 	trace_value(source->params.pcm->rate);
 	trace_value(sink->params.pcm->rate);
 #endif
 
-	//dev->preload = PLAT_INT_PERIODS;
 	dev->state = COMP_STATE_PREPARE;
 	return 0;
 }
 
 static int src_preload(struct comp_dev *dev)
 {
-	//int i;
 	trace_src("SPl");
 
-
-	//for (i = 0; i < dev->preload; i++)
-	//    src_copy(dev);
-
-	return 0;
+	return comp_preload_period(dev);
 }
 
 static int src_reset(struct comp_dev *dev)
@@ -578,6 +572,8 @@ static int src_reset(struct comp_dev *dev)
 
 struct comp_driver comp_src = {
 	.type = SOF_COMP_SRC,
+	.formats_in = COMP_FMT(SOF_IPC_FRAME_S32_LE),
+	.formats_out = COMP_FMT(SOF_IPC_FRAME_S32_LE),
 	.ops = {
 		.new = src_new,
 		.free = src_free,
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #endif
 
+#include <reef/reef.h>
 #include <reef/alloc.h>
 #include <reef/audio/format.h>
 #include <reef/math/numbers.h>
@@ -338,7 +339,7 @@ static inline int32_t fir_filter(
 	return (int32_t)sat_int32(y);
 }
 
-void src_polyphase_stage_cir(struct src_stage_prm *s)
+void __hot_text src_polyphase_stage_cir(struct src_stage_prm *s)
 {
 	int n;
 	int m;
@@ -93,7 +93,7 @@ static void tone_s32_default(struct comp_dev *dev, struct comp_buffer *sink,
 	int32_t sine_sample;
 	int32_t *dest = (int32_t *) sink->w_ptr;
 	int i, n, n_wrap_dest;
-	int nch = sink->params.pcm->channels;
+	int nch = sink->channels;
 
 	n = frames * nch;
 	while (n > 0) {
@@ -406,7 +406,7 @@ static int tone_params(struct comp_dev *dev, struct stream_params *params)
 
 	/* Tone generator supports only S32_LE PCM format */
 	if ((params->type != STREAM_TYPE_PCM)
-		|| (params->pcm->frame_fmt != SOF_IPC_FRAME_S32_LE))
+		|| (comp_sink_frame_fmt(dev) != SOF_IPC_FRAME_S32_LE))
 		return -EINVAL;
 
 	/* Don't do any data transformation */
@@ -489,12 +489,12 @@ static int tone_copy(struct comp_dev *dev)
 	/* tone component sink buffer */
 	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
 		source_list);
-	cframes = sink->params.pcm->period_count;
+	cframes = dev->period_frames;
 
 	/* Test that sink has enough free frames. Then run once to maintain
 	 * low latency and steady load for tones.
 	 */
-	need_sink = cframes * sink->params.pcm->frame_size;
+	need_sink = cframes * sink->frame_size;
 	if (sink->free >= need_sink) {
 		/* create tone */
 		cd->tone_func(dev, sink, source, cframes);
@@ -513,7 +513,7 @@ static int tone_prepare(struct comp_dev *dev)
 
 	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
 		source_list);
-	trace_value(sink->params.pcm->channels);
+	trace_value(sink->channels);
 	trace_value(sink->params.pcm->rate);
 
 	f = tonegen_get_f(&cd->sg);
@@ -521,7 +521,6 @@ static int tone_prepare(struct comp_dev *dev)
 	if (tonegen_init(&cd->sg, sink->params.pcm->rate, f, a) < 0)
 		return -EINVAL;
 
-	//dev->preload = PLAT_INT_PERIODS;
 	dev->state = COMP_STATE_PREPARE;
 
 	return 0;
@@ -529,13 +528,10 @@ static int tone_prepare(struct comp_dev *dev)
 
 static int tone_preload(struct comp_dev *dev)
 {
-	//int i;
 	trace_tone("TPl");
 
-	//for (i = 0; i < dev->preload; i++)
-	//	tone_copy(dev);
-
-	return 0;
+	/* tone only generates a period if sink has space */
+	return tone_copy(dev);
 }
 
 static int tone_reset(struct comp_dev *dev)
@@ -555,6 +551,7 @@ static int tone_reset(struct comp_dev *dev)
 
 struct comp_driver comp_tone = {
 	.type = SOF_COMP_TONE,
+	.formats_out = COMP_FMT(SOF_IPC_FRAME_S32_LE),
 	.ops = {
 		.new = tone_new,
 		.free = tone_free,
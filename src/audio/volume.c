@@ -39,6 +39,7 @@
 #include <reef/alloc.h>
 #include <reef/work.h>
 #include <reef/clock.h>
+#include <reef/mailbox.h>
 #include <reef/audio/component.h>
 #include <reef/audio/pipeline.h>
 
@@ -69,83 +70,81 @@ struct comp_data {
 	uint32_t volume[PLATFORM_MAX_CHANNELS];	/* current volume */
 	uint32_t tvolume[PLATFORM_MAX_CHANNELS];	/* target volume */
 	uint32_t mvolume[PLATFORM_MAX_CHANNELS];	/* mute volume */
-	void (*scale_vol)(struct comp_dev *dev, struct comp_buffer *sink,
-		struct comp_buffer *source, uint32_t frames);
+	void (*scale_vol)(struct comp_dev *dev, void *sink, void *source,
+		uint32_t frames);
 	struct work volwork;
 
 	/* host volume readback */
 	struct sof_ipc_ctrl_values *hvol;
+
+	/* host shared memory volume control */
+	struct sof_ipc_ctrl_mmap_vol *mvol[PLATFORM_MAX_CHANNELS];
+	uint32_t mvol_seq[PLATFORM_MAX_CHANNELS];	/* last seq read */
+	uint32_t mvol_channels;		/* stream channels */
+	uint32_t mvol_unmapped;		/* stream channels without a slot */
+	uint32_t mvol_rescan;		/* control changed, look for slots */
 };
 
 struct comp_func_map {
 	uint16_t source;	/* source format */
 	uint16_t sink;		/* sink format */
 	uint16_t channels;	/* channel number for the stream */
-	void (*func)(struct comp_dev *dev, struct comp_buffer *sink,
-		struct comp_buffer *source, uint32_t frames);
+	void (*func)(struct comp_dev *dev, void *sink, void *source,
+		uint32_t frames);
 };
 
 /* copy and scale volume from 16 bit source buffer to 32 bit dest buffer */
-static void vol_s16_to_s32(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s16_to_s32(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int16_t *src = (int16_t*) source->r_ptr;
-	int32_t i, *dest = (int32_t*) sink->w_ptr;
+	int16_t *src = (int16_t*) source;
+	int32_t i, *dest = (int32_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
 		dest[i] = (int32_t)src[i] * cd->volume[0];
 		dest[i + 1] = (int32_t)src[i + 1] * cd->volume[1];
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 32 bit source buffer to 16 bit dest buffer */
-static void vol_s32_to_s16(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s32_to_s16(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int32_t i, *src = (int32_t*) source->r_ptr;
-	int16_t *dest = (int16_t*) sink->w_ptr;
+	int32_t i, *src = (int32_t*) source;
+	int16_t *dest = (int16_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
 		dest[i] = (((int32_t)src[i] >> 16) * cd->volume[0]) >> 16;
 		dest[i + 1] = (((int32_t)src[i + 1] >> 16) * cd->volume[1]) >> 16;
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 32 bit source buffer to 32 bit dest buffer */
-static void vol_s32_to_s32(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s32_to_s32(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int32_t *src = (int32_t*) source->r_ptr;
-	int32_t i, *dest = (int32_t*) sink->w_ptr;
+	int32_t *src = (int32_t*) source;
+	int32_t i, *dest = (int32_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
 		dest[i] = ((int64_t)src[i] * cd->volume[0]) >> 16;
 		dest[i + 1] = ((int64_t)src[i + 1] * cd->volume[1]) >> 16;
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 16 bit source buffer to 16 bit dest buffer */
-static void vol_s16_to_s16(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s16_to_s16(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int16_t *src = (int16_t*) source->r_ptr;
-	int16_t *dest = (int16_t*) sink->w_ptr;
+	int16_t *src = (int16_t*) source;
+	int16_t *dest = (int16_t*) sink;
 	int32_t i;
 
 	/* buffer sizes are always divisible by period frames */
@@ -153,36 +152,30 @@ static void vol_s16_to_s16(struct comp_dev *dev, struct comp_buffer *sink,
 		dest[i] = ((int32_t)src[i] * cd->volume[0]) >> 16;
 		dest[i + 1] = ((int32_t)src[i + 1] * cd->volume[1]) >> 16;
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 16 bit source buffer to 24 bit on 32 bit boundary dest buffer */
-static void vol_s16_to_s24(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s16_to_s24(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int16_t *src = (int16_t*) source->r_ptr;
-	int32_t i, *dest = (int32_t*) sink->w_ptr;
+	int16_t *src = (int16_t*) source;
+	int32_t i, *dest = (int32_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
 		dest[i] = ((int32_t)src[i] * cd->volume[0]) >> 8;
 		dest[i + 1] = ((int32_t)src[i + 1] * cd->volume[1]) >> 8;
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 16 bit source buffer to 24 bit on 32 bit boundary dest buffer */
-static void vol_s24_to_s16(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s24_to_s16(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int32_t i, *src = (int32_t*) source->r_ptr;
-	int16_t *dest = (int16_t*) sink->w_ptr;
+	int32_t i, *src = (int32_t*) source;
+	int16_t *dest = (int16_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
@@ -191,36 +184,30 @@ static void vol_s24_to_s16(struct comp_dev *dev, struct comp_buffer *sink,
 		dest[i + 1] = (int16_t)((((int32_t)src[i + 1] >> 8) *
 			cd->volume[1]) >> 16);
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 32 bit source buffer to 24 bit on 32 bit boundary dest buffer */
-static void vol_s32_to_s24(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s32_to_s24(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int32_t *src = (int32_t*) source->r_ptr;
-	int32_t i, *dest = (int32_t*) sink->w_ptr;
+	int32_t *src = (int32_t*) source;
+	int32_t i, *dest = (int32_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
 		dest[i] = ((int64_t)src[i] * cd->volume[0]) >> 24;
 		dest[i + 1] = ((int64_t)src[i + 1] * cd->volume[1]) >> 24;
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* copy and scale volume from 16 bit source buffer to 24 bit on 32 bit boundary dest buffer */
-static void vol_s24_to_s32(struct comp_dev *dev, struct comp_buffer *sink,
-	struct comp_buffer *source, uint32_t frames)
+static void __hot_text vol_s24_to_s32(struct comp_dev *dev, void *sink,
+	void *source, uint32_t frames)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
-	int32_t i, *src = (int32_t*) source->r_ptr;
-	int32_t *dest = (int32_t*) sink->w_ptr;
+	int32_t i, *src = (int32_t*) source;
+	int32_t *dest = (int32_t*) sink;
 
 	/* buffer sizes are always divisible by period frames */
 	for (i = 0; i < frames * 2; i += 2) {
@@ -229,9 +216,6 @@ static void vol_s24_to_s32(struct comp_dev *dev, struct comp_buffer *sink,
 		dest[i + 1] = (int32_t)(((int64_t)src[i + 1] *
 			cd->volume[1]) >> 8);
 	}
-
-	source->r_ptr = src + i;
-	sink->w_ptr = dest + i;
 }
 
 /* map of source and sink buffer formats to volume function */
@@ -244,6 +228,8 @@ static const struct comp_func_map func_map[] = {
 	{SOF_IPC_FRAME_S24_4LE, SOF_IPC_FRAME_S16_LE, 2, vol_s24_to_s16},
 	{SOF_IPC_FRAME_S32_LE, SOF_IPC_FRAME_S24_4LE, 2, vol_s32_to_s24},
 	{SOF_IPC_FRAME_S24_4LE, SOF_IPC_FRAME_S32_LE, 2, vol_s24_to_s32},
+	/* same container and scaling as 32 bit */
+	{SOF_IPC_FRAME_S24_4LE, SOF_IPC_FRAME_S24_4LE, 2, vol_s32_to_s32},
 };
 
 /* synchronise host mmap() volume with real value */
@@ -350,6 +336,7 @@ static struct comp_dev *volume_new(struct sof_ipc_comp *comp)
 	for (i = 0; i < PLATFORM_MAX_CHANNELS; i++) {
 		cd->volume[i] = VOL_MAX;
 		cd->tvolume[i] = VOL_MAX;
+		cd->mvol[i] = NULL;
 	}
 
 	return dev;
@@ -366,27 +353,7 @@ static void volume_free(struct comp_dev *dev)
 /* set component audio stream paramters */
 static int volume_params(struct comp_dev *dev, struct stream_params *params)
 {
-	struct stream_params buffer_params = *params;
-	struct comp_buffer *next_buf;
-	struct comp_dev *next_dev;
-
-	/* volume components will only ever have one sink & one source buffer */
-	next_buf = list_first_item(&dev->bsource_list, struct comp_buffer, sink_list);
-	next_dev = next_buf->source;
-
-	/* hard coded until new IPC is ready */
-	if (next_dev->comp.type == SOF_COMP_HOST) {
-		buffer_params.pcm->frame_fmt = SOF_IPC_FRAME_S16_LE;
-		buffer_params.pcm->frame_size = 2 * params->pcm->channels; /* 16bit container */
-	} else if (next_dev->comp.type == SOF_COMP_DAI) {
-		buffer_params.pcm->frame_fmt = PLATFORM_SSP_STREAM_FORMAT;
-		buffer_params.pcm->frame_size = 4 * params->pcm->channels; /* 32bit container */
-	} else {
-		buffer_params.pcm->frame_fmt = SOF_IPC_FRAME_S32_LE;
-		buffer_params.pcm->frame_size = 4 * params->pcm->channels; /* 32bit container */
-	}
-
-	/* dont do any data transformation */
+	/* buffer formats are negotiated by the pipeline */
 	comp_buffer_sink_params(dev, params);
 
 	return 0;
@@ -416,6 +383,84 @@ static inline void volume_set_chan_unmute(struct comp_dev *dev, int chan)
 	cd->tvolume[chan] = cd->mvolume[chan];
 }
 
+/* find host shared memory volume slots for channels without one */
+static void volume_mmap_map(struct comp_dev *dev)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	struct sof_ipc_ctrl_mmap_vol *mvol =
+		(struct sof_ipc_ctrl_mmap_vol *)mailbox_get_control_base();
+	int i, j;
+
+	dcache_invalidate_region(mvol, sizeof(*mvol) * PLATFORM_NUM_MMAP_VOL);
+
+	cd->mvol_unmapped = 0;
+	cd->mvol_rescan = 0;
+
+	for (i = 0; i < cd->mvol_channels; i++) {
+		if (cd->mvol[i] != NULL)
+			continue;
+
+		for (j = 0; j < PLATFORM_NUM_MMAP_VOL; j++) {
+			if (mvol[j].seq != 0 && mvol[j].comp_id == dev->comp.id &&
+				mvol[j].channel == cd->chan[i]) {
+				cd->mvol[i] = &mvol[j];
+				cd->mvol_seq[i] = 0;
+				break;
+			}
+		}
+
+		if (cd->mvol[i] == NULL)
+			cd->mvol_unmapped++;
+	}
+}
+
+/* read any new volumes written by host to shared memory, no locks needed */
+static void volume_mmap_poll(struct comp_dev *dev)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+	volatile struct sof_ipc_ctrl_mmap_vol *mvol;
+	uint32_t seq, value;
+	int i, update = 0;
+
+	/* host can set up slots whilst the stream is running */
+	if (cd->mvol_unmapped && cd->mvol_rescan)
+		volume_mmap_map(dev);
+
+	for (i = 0; i < cd->mvol_channels; i++) {
+
+		mvol = cd->mvol[i];
+		if (mvol == NULL)
+			continue;
+
+		dcache_invalidate_region((void *)mvol, sizeof(*mvol));
+
+		/* skip if unchanged or host is writing, try again next period */
+		seq = mvol->seq;
+		if (seq == cd->mvol_seq[i] || (seq & 0x1))
+			continue;
+
+		value = mvol->value;
+
+		/* host updated slot whilst we read it, try again next period */
+		dcache_invalidate_region((void *)mvol, sizeof(*mvol));
+		if (mvol->seq != seq)
+			continue;
+
+		cd->mvol_seq[i] = seq;
+
+		if (value & SOF_IPC_MMAP_VOL_MUTE) {
+			if (cd->tvolume[i] != 0)
+				volume_set_chan_mute(dev, i);
+		} else
+			volume_set_chan(dev, i, value);
+
+		update = 1;
+	}
+
+	if (update)
+		work_schedule_default(&cd->volwork, VOL_RAMP_US);
+}
+
 /* used to pass standard and bespoke commands (with data) to component */
 static int volume_cmd(struct comp_dev *dev, int cmd, void *data)
 {
@@ -423,6 +468,11 @@ static int volume_cmd(struct comp_dev *dev, int cmd, void *data)
 	struct sof_ipc_ctrl_values *cv;
 	int i, j;
 
+	/* look for new shared memory slots when the host changes the control */
+	if (cmd == COMP_CMD_VOLUME || cmd == COMP_CMD_MUTE ||
+		cmd == COMP_CMD_UNMUTE)
+		cd->mvol_rescan = 1;
+
 	switch (cmd) {
 	case COMP_CMD_VOLUME:
 		cv = (struct sof_ipc_ctrl_values*)data;
@@ -489,10 +539,13 @@ static int volume_copy(struct comp_dev *dev)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
 	struct comp_buffer *sink, *source;
-	uint32_t cframes = PLAT_INT_PERIOD_FRAMES;
+	uint32_t cframes = dev->period_frames;
 
 	trace_comp("Vol");
 
+	/* apply any volume changes from host shared memory */
+	volume_mmap_poll(dev);
+
 	/* volume components will only ever have 1 source and 1 sink buffer */
 	source = list_first_item(&dev->bsource_list, struct comp_buffer, sink_list);
 	sink = list_first_item(&dev->bsink_list, struct comp_buffer, source_list);
@@ -502,18 +555,26 @@ static int volume_copy(struct comp_dev *dev)
 	trace_value((uint32_t)(sink->w_ptr - sink->addr));
 #endif
 
-	if (source->avail < cframes * source->params.pcm->frame_size ||
-			sink->free < cframes * sink->params.pcm->frame_size)
-		cframes = source->avail / source->params.pcm->frame_size;
+	if (source->avail < cframes * source->frame_size ||
+			sink->free < cframes * sink->frame_size) {
+
+		/* record which side could not keep up */
+		if (source->avail < cframes * source->frame_size)
+			comp_buffer_xrun(source, BUFFER_XRUN_UNDERRUN);
+		else
+			comp_buffer_xrun(sink, BUFFER_XRUN_OVERRUN);
+
+		cframes = source->avail / source->frame_size;
+	}
 
 	/* no data to copy */
-	if (cframes == 0) {
-		trace_value(source->avail);
+	if (cframes == 0)
 		return 0;
-	}
 
 	/* copy and scale volume */
-	cd->scale_vol(dev, sink, source, cframes);
+	cd->scale_vol(dev, sink->w_ptr, source->r_ptr, cframes);
+	source->r_ptr += cframes * source->frame_size;
+	sink->w_ptr += cframes * sink->frame_size;
 
 	/* update buffer pointers for overflow */
 	if (source->r_ptr >= source->end_addr)
@@ -528,6 +589,20 @@ static int volume_copy(struct comp_dev *dev)
 	return 0;
 }
 
+/* scale span of fused run, poll host volume at period start */
+static int volume_process(struct comp_dev *dev, void *src, void *dst,
+	uint32_t frames)
+{
+	struct comp_data *cd = comp_get_drvdata(dev);
+
+	if (frames == 0)
+		volume_mmap_poll(dev);
+	else
+		cd->scale_vol(dev, dst, src, frames);
+
+	return 0;
+}
+
 static int volume_prepare(struct comp_dev *dev)
 {
 	struct comp_data *cd = comp_get_drvdata(dev);
@@ -539,18 +614,9 @@ static int volume_prepare(struct comp_dev *dev)
 	source = list_first_item(&dev->bsource_list, struct comp_buffer, sink_list);
 	sink = list_first_item(&dev->bsink_list, struct comp_buffer, source_list);
 
-	/* is source a host or DAI ? */
-	if (source->source->is_endpoint || source->source->is_endpoint)
-		source_format = source->params.pcm->frame_fmt;
-	else
-		source_format = SOF_IPC_FRAME_S32_LE;
-
-	/* TODO tmp hard coded for 24 bit - need fixed for capture*/
-	/* is sink a host or DAI ? */
-	if (sink->sink->is_endpoint || sink->sink->is_endpoint)
-		sink_format = sink->params.pcm->frame_fmt;
-	else
-		sink_format = SOF_IPC_FRAME_S32_LE;
+	/* formats are negotiated by the pipeline */
+	source_format = source->frame_fmt;
+	sink_format = sink->frame_fmt;
 
 	/* map the volume function for source and sink buffers */
 	for (i = 0; i < ARRAY_SIZE(func_map); i++) {
@@ -559,7 +625,7 @@ static int volume_prepare(struct comp_dev *dev)
 			continue;
 		if (sink_format != func_map[i].sink)
 			continue;
-		if (sink->params.pcm->channels != func_map[i].channels)
+		if (sink->channels != func_map[i].channels)
 			continue;
 
 		cd->scale_vol = func_map[i].func;
@@ -572,19 +638,19 @@ found:
 	for (i = 0; i < PLATFORM_MAX_CHANNELS; i++)
 		vol_sync_host(cd, i);
 
-	//dev->preload = PLAT_INT_PERIODS;
+	/* use any host shared memory volume slots for this component */
+	for (i = 0; i < PLATFORM_MAX_CHANNELS; i++)
+		cd->mvol[i] = NULL;
+	cd->mvol_channels = sink->channels;
+	volume_mmap_map(dev);
+
 	dev->state = COMP_STATE_PREPARE;
 	return 0;
 }
 
 static int volume_preload(struct comp_dev *dev)
 {
-	//int i, count;
-
-//	for (i = 0; i < dev->preload; i++)
-	//	volume_copy(dev);
-
-	return 0;
+	return comp_preload_period(dev);
 }
 
 static int volume_reset(struct comp_dev *dev)
@@ -596,12 +662,19 @@ static int volume_reset(struct comp_dev *dev)
 
 struct comp_driver comp_volume = {
 	.type	= SOF_COMP_VOLUME,
+	.flags	= COMP_DRV_FMT_CONVERT | COMP_DRV_INPLACE |
+		COMP_DRV_PERIOD,
+	.formats_in	= COMP_FMT(SOF_IPC_FRAME_S16_LE) |
+		COMP_FMT(SOF_IPC_FRAME_S24_4LE) | COMP_FMT(SOF_IPC_FRAME_S32_LE),
+	.formats_out	= COMP_FMT(SOF_IPC_FRAME_S16_LE) |
+		COMP_FMT(SOF_IPC_FRAME_S24_4LE) | COMP_FMT(SOF_IPC_FRAME_S32_LE),
 	.ops	= {
 		.new		= volume_new,
 		.free		= volume_free,
 		.params		= volume_params,
 		.cmd		= volume_cmd,
 		.copy		= volume_copy,
+		.process	= volume_process,
 		.prepare	= volume_prepare,
 		.reset		= volume_reset,
 		.preload	= volume_preload,
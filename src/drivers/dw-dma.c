@@ -164,6 +164,7 @@ struct dma_chan_data {
 	int32_t drain_count;
 	struct dw_lli2 *lli;
 	struct dw_lli2 *lli_current;
+	struct dw_lli2 lli_boot __attribute__((aligned(4)));	/* 1 desc */
 	uint32_t desc_count;
 	uint32_t cfg_lo;
 	uint32_t cfg_hi;
@@ -184,6 +185,7 @@ struct dma_pdata {
 };
 
 static inline void dw_dma_chan_reload_lli(struct dma *dma, int channel);
+static void dw_dma_lli_free(struct dma_chan_data *chan);
 static inline void dw_dma_chan_reload_next(struct dma *dma, int channel,
 		struct dma_sg_elem *next);
 
@@ -272,10 +274,7 @@ static void dw_dma_channel_put_unlocked(struct dma *dma, int channel)
 	dw_write(dma, DW_MASK_ERR, INT_MASK(channel));
 
 	/* free the lli allocated by set_config*/
-	if (p->chan[channel].lli) {
-		rfree(p->chan[channel].lli);
-		p->chan[channel].lli = NULL;
-	}
+	dw_dma_lli_free(&p->chan[channel]);
 
 	/* set new state */
 	p->chan[channel].status = DMA_STATUS_FREE;
@@ -549,6 +548,14 @@ static int dw_dma_status(struct dma *dma, int channel,
 	return 0;
 }
 
+/* free descriptors unless they are the boot descriptor */
+static void dw_dma_lli_free(struct dma_chan_data *chan)
+{
+	if (chan->lli && chan->lli != &chan->lli_boot)
+		rfree(chan->lli);
+	chan->lli = NULL;
+}
+
 /* set the DMA channel configuration, source/target address, buffer sizes */
 static int dw_dma_set_config(struct dma *dma, int channel,
 	struct dma_sg_config *config)
@@ -583,10 +590,15 @@ static int dw_dma_set_config(struct dma *dma, int channel,
 		p->chan[channel].desc_count = desc_count;
 
 		/* allocate descriptors for channel */
-		if (p->chan[channel].lli)
-			rfree(p->chan[channel].lli);
-		p->chan[channel].lli = rzalloc(RZONE_RUNTIME, RFLAGS_NONE,
-			sizeof(struct dw_lli2) * p->chan[channel].desc_count);
+		dw_dma_lli_free(&p->chan[channel]);
+
+		/* single copies never allocate so heaps can be saved by DMA */
+		if (desc_count == 1)
+			p->chan[channel].lli = &p->chan[channel].lli_boot;
+		else
+			p->chan[channel].lli = rzalloc(RZONE_RUNTIME,
+				RFLAGS_NONE,
+				sizeof(struct dw_lli2) * desc_count);
 		if (p->chan[channel].lli == NULL) {
 			trace_dma_error("eDm");
 			return -ENOMEM;
@@ -64,6 +64,7 @@ struct reef;
 #define RFLAGS_ATOMIC	2   /* allocation with IRQs off */
 #define RFLAGS_DMA		4   /* DMA-able memory */
 #define RFLAGS_POWER	8   /* low power memory */
+#define RFLAGS_BOOT	0x8000	/* boot alloc, not in PM context */
 
 struct mm_info {
 	uint32_t used;
@@ -86,7 +87,9 @@ void *memset(void *s, int c, size_t n);
 /* Heap save/restore contents and context for PM D0/D3 events */
 uint32_t mm_pm_context_size(void);
 int mm_pm_context_save(struct dma_sg_config *sg);
+int mm_pm_context_commit(struct dma_sg_config *sg);
 int mm_pm_context_restore(struct dma_sg_config *sg);
+void mm_pm_boot_complete(void);
 
 /* heap initialisation */
 void init_heap(struct reef *reef);
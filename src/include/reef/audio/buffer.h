@@ -47,6 +47,24 @@
 #define trace_buffer_error(__e)	trace_error(TRACE_CLASS_BUFFER, __e)
 #define tracev_buffer(__e)	tracev_event(TRACE_CLASS_BUFFER, __e)
 
+/* buffer xrun types */
+#define BUFFER_XRUN_UNDERRUN	0
+#define BUFFER_XRUN_OVERRUN	1
+
+/* min time between xrun notifications of a buffer, later xruns are batched */
+#define BUFFER_XRUN_NOTIFY_US	10000
+
+/* buffer health statistics */
+struct comp_buffer_stats {
+	uint32_t underruns;	/* reader found too little data */
+	uint32_t overruns;	/* writer found too little space */
+	uint32_t high_water;	/* max avail bytes after produce */
+	uint32_t low_water;	/* min avail bytes after consume */
+	uint32_t last_xrun;	/* wall clock time of last xrun */
+	uint32_t xrun_pending;	/* xrun not yet notified to host */
+	uint32_t last_notify;	/* wall clock time of last notification */
+};
+
 /* audio component buffer - connects 2 audio components together in pipeline */
 struct comp_buffer {
 
@@ -61,23 +79,80 @@ struct comp_buffer {
 	void *addr;		/* buffer base address */
 	void *end_addr;		/* buffer end address */
 
+	/* health statistics */
+	struct comp_buffer_stats stats;
+
 	/* IPC configuration */
 	struct sof_ipc_buffer ipc_buffer;
 	struct stream_params params;
 
+	/* negotiated frame format */
+	enum sof_ipc_frame frame_fmt;
+	uint32_t frame_size;	/* in bytes, 0 if not negotiated */
+	uint32_t channels;	/* negotiated channels */
+	uint32_t fmt_mask;	/* candidate formats during negotiation */
+
 	/* connected components */
 	struct comp_dev *source;	/* source component */
 	struct comp_dev *sink;		/* sink component */
 
+	/* in place processing - sink buffer uses source buffer memory */
+	struct comp_buffer *alias;	/* sink buffer using our memory */
+	struct comp_buffer *alias_of;	/* source buffer we use memory of */
+
+	/* scratch memory - shared with buffers not live at the same time */
+	void *scratch_addr;		/* address in scratch pool or NULL */
+	struct scratch_pool *scratch_pool;	/* pipeline scratch pool */
+
+	/* FIFO between pipelines running at their own periods */
+	uint32_t fifo;			/* connects two pipelines */
+	uint32_t fifo_low;		/* free bytes to run source pipeline */
+	uint32_t fifo_high;		/* avail bytes to run sink pipeline */
+	struct list_item fifo_list;	/* list in sink pipeline FIFOs */
+
 	/* lists */
 	struct list_item source_list;	/* list in comp buffers */
 	struct list_item sink_list;	/* list in comp buffers */
+	struct list_item pipe_list;	/* list in pipeline buffers */
 };
 
 /* pipeline buffer creation and destruction */
 struct comp_buffer *buffer_new(struct sof_ipc_buffer *desc);
 void buffer_free(struct comp_buffer *buffer);
 
+/* buffer memory is allocated on demand or placed in scratch pool */
+int buffer_alloc(struct comp_buffer *buffer);
+void buffer_scratch_set(struct comp_buffer *buffer, void *addr);
+
+/* record buffer xrun and notify host */
+void comp_buffer_xrun(struct comp_buffer *buffer, int type);
+
+/* share buffer memory for in place processing */
+void buffer_alias(struct comp_buffer *source, struct comp_buffer *sink);
+int buffer_unalias(struct comp_buffer *sink);
+
+/*
+ * Aliased buffers share one ring. Data not yet processed in place is in the
+ * source buffer and processed data not yet consumed is in the sink buffer,
+ * so the source can only be written to space that holds neither.
+ */
+static inline void comp_update_buffer_alias(struct comp_buffer *buffer)
+{
+	struct comp_buffer *source, *sink;
+
+	if (buffer->alias_of) {
+		source = buffer->alias_of;
+		sink = buffer;
+	} else if (buffer->alias) {
+		source = buffer;
+		sink = buffer->alias;
+	} else
+		return;
+
+	source->free = source->ipc_buffer.size - source->avail - sink->avail;
+	sink->free = sink->ipc_buffer.size - sink->avail;
+}
+
 static inline void comp_update_buffer_produce(struct comp_buffer *buffer)
 {
 	if (buffer->r_ptr < buffer->w_ptr)
@@ -88,6 +163,10 @@ static inline void comp_update_buffer_produce(struct comp_buffer *buffer)
 		buffer->avail = buffer->end_addr - buffer->r_ptr +
 			buffer->w_ptr - buffer->addr;
 	buffer->free = buffer->ipc_buffer.size - buffer->avail;
+	comp_update_buffer_alias(buffer);
+
+	if (buffer->avail > buffer->stats.high_water)
+		buffer->stats.high_water = buffer->avail;
 }
 
 static inline void comp_update_buffer_consume(struct comp_buffer *buffer)
@@ -100,12 +179,17 @@ static inline void comp_update_buffer_consume(struct comp_buffer *buffer)
 		buffer->avail = buffer->end_addr - buffer->r_ptr +
 			buffer->w_ptr - buffer->addr;
 	buffer->free = buffer->ipc_buffer.size - buffer->avail;
+	comp_update_buffer_alias(buffer);
+
+	if (buffer->avail < buffer->stats.low_water)
+		buffer->stats.low_water = buffer->avail;
 }
 
 static inline void comp_update_source_free_avail(struct comp_buffer *src, int n)
 {
         src->avail -= sizeof(int32_t)*n;
         src->free += sizeof(int32_t)*n;
+        comp_update_buffer_alias(src);
 }
 
 
@@ -113,6 +197,7 @@ static inline void comp_update_sink_free_avail(struct comp_buffer *snk, int n)
 {
         snk->avail += sizeof(int32_t)*n;
         snk->free -= sizeof(int32_t)*n;
+        comp_update_buffer_alias(snk);
 }
 
 
@@ -80,6 +80,7 @@
 #define COMP_CMD_EQ_FIR_SWITCH  108     /* Update request for FIR EQ */
 #define COMP_CMD_EQ_IIR_CONFIG  109     /* Configuration data for IIR EQ */
 #define COMP_CMD_EQ_IIR_SWITCH  110     /* Response update request for IIR EQ */
+#define COMP_CMD_POSN_NOTIFY	111	/* host position IPC interval */
 
 /* MMAP IPC status */
 #define COMP_CMD_IPC_MMAP_RPOS	200	/* host read position */
@@ -118,7 +119,7 @@ struct comp_ops {
 	/* set component audio stream paramters */
 	int (*params)(struct comp_dev *dev, struct stream_params *params);
 
-	/* preload buffers */
+	/* copy one preload period before start - >0 if already active */
 	int (*preload)(struct comp_dev *dev);
 
 	/* set component audio stream paramters */
@@ -136,16 +137,36 @@ struct comp_ops {
 	/* copy and process stream data from source to sink buffers */
 	int (*copy)(struct comp_dev *dev);
 
+	/* process frames from source to sink memory in a fused run - optional.
+	 * Called for each span of a period after a 0 frame call at period start.
+	 */
+	int (*process)(struct comp_dev *dev, void *src, void *dst,
+		uint32_t frames);
+
 	/* host buffer config */
 	int (*host_buffer)(struct comp_dev *dev, struct dma_sg_elem *elem,
 			uint32_t host_size);
 };
 
 
+/* frame format capability mask */
+#define COMP_FMT(f)		(1 << (f))
+#define COMP_FMT_ANY		0xffffffff
+
+/* driver flags */
+#define COMP_DRV_FMT_CONVERT	(1 << 0)	/* source and sink can differ */
+#define COMP_DRV_INPLACE	(1 << 1)	/* can process source in place */
+#define COMP_DRV_PERIOD		(1 << 2)	/* consumes all source data per copy */
+
 /* audio component base driver "class" - used by all other component types */
 struct comp_driver {
 	uint32_t type;		/* SOF_COMP_ for driver */
 	uint32_t module_id;
+	uint32_t flags;		/* COMP_DRV_ */
+
+	/* frame formats accepted from source and produced to sink buffers */
+	uint32_t formats_in;	/* COMP_FMT() mask, 0 for any */
+	uint32_t formats_out;	/* COMP_FMT() mask, 0 for any */
 
 	struct comp_ops ops;	/* component operations */
 
@@ -162,6 +183,11 @@ struct comp_dev {
 	struct pipeline *pipeline;	/* pipeline we belong to */
 	uint32_t period_frames;	/* frames to process per period - 0 is variable */
 	uint32_t period_bytes;	/* bytes to process per period - 0 is variable */
+	uint32_t sink_channels;	/* channels produced - 0 is same as source */
+
+	/* fused execution - run is copied by its first component */
+	struct comp_dev *fuse_head;	/* first component of run or NULL */
+	struct comp_dev *fuse_tail;	/* last component of run if head */
 
 	/* driver */
 	struct comp_driver *drv;
@@ -269,6 +295,7 @@ void sys_comp_eq_iir_init(void);
 
 
 void sys_comp_eq_fir_init(void);
+void sys_comp_convert_init(void);
 
 static inline void comp_set_endpoint(struct comp_dev *dev)
 {
@@ -301,6 +328,25 @@ static inline int comp_buffer_reset(struct comp_dev *dev)
 	return 0;
 }
 
+/* copy one preload period if source has it and sink has space for it */
+static inline int comp_preload_period(struct comp_dev *dev)
+{
+	struct comp_buffer *source, *sink;
+	int ret;
+
+	source = list_first_item(&dev->bsource_list, struct comp_buffer,
+		sink_list);
+	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+
+	if (source->avail < dev->period_frames * source->frame_size ||
+		sink->free < dev->period_frames * sink->frame_size)
+		return 0;
+
+	ret = comp_copy(dev);
+	return ret < 0 ? ret : 0;
+}
+
 static inline void comp_buffer_sink_params(struct comp_dev *dev,
 	struct stream_params *params)
 {
@@ -327,6 +373,31 @@ static inline void comp_set_source_params(struct comp_dev *dev,
 	}
 }
 
+/* sample container size in bytes for frame format */
+static inline uint32_t comp_sample_bytes(enum sof_ipc_frame fmt)
+{
+	switch (fmt) {
+	case SOF_IPC_FRAME_S16_LE:
+		return 2;
+	case SOF_IPC_FRAME_S24_3LE:
+		return 3;
+	case SOF_IPC_FRAME_S24_4LE:
+	case SOF_IPC_FRAME_S32_LE:
+	default:
+		return 4;
+	}
+}
+
+/* negotiated frame format of component sink buffer */
+static inline enum sof_ipc_frame comp_sink_frame_fmt(struct comp_dev *dev)
+{
+	struct comp_buffer *sink;
+
+	sink = list_first_item(&dev->bsink_list, struct comp_buffer,
+		source_list);
+	return sink->frame_fmt;
+}
+
 /* get a components preload period count from source buffer */
 static inline uint32_t comp_get_preload_count(struct comp_dev *dev)
 {
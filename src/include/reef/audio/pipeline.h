@@ -40,6 +40,7 @@
 #include <reef/audio/component.h>
 #include <reef/trace.h>
 #include <reef/schedule.h>
+#include <reef/work.h>
 #include <uapi/ipc.h>
 
 /* pipeline tracing */
@@ -47,6 +48,10 @@
 #define trace_pipe_error(__e)	trace_error(TRACE_CLASS_PIPE, __e)
 #define tracev_pipe(__e)	tracev_event(TRACE_CLASS_PIPE, __e)
 
+/* fused runs are copied a chunk at a time through a small scratch */
+#define PIPELINE_FUSE_FRAMES	16
+#define PIPELINE_FUSE_CHANNELS	8
+
 struct ipc_pipeline_dev;
 struct ipc;
 
@@ -57,15 +62,47 @@ struct pipeline {
 	uint32_t id;		/* id */
 	spinlock_t lock;
 	struct sof_ipc_pipe_new ipc_pipe;
+	uint32_t period_frames;	/* frames processed by components per period */
+	uint32_t deadline;	/* period copy deadline in us */
+	int32_t priority;	/* task priority TASK_PRI_ */
 
 	/* lists */
 	struct list_item comp_list;		/* list of components */
 	struct list_item buffer_list;		/* list of buffers */
+	struct list_item fifo_list;		/* FIFOs read from other pipelines */
 
 	/* scheduling */
 	struct task pipe_task;		/* pipeline processing task */
+
+	/* timer scheduling */
+	struct work sched_work;		/* period timer */
+	struct comp_dev *sched_comp;	/* component copy is scheduled from */
+	uint32_t sched_period;		/* timer period in us */
+	uint32_t sched_last;		/* time of last timer copy */
+	uint32_t dma_periods;		/* DAI DMA periods per IRQ */
+
+	/* in place processing */
+	uint32_t inplace_bytes;		/* buffer memory released */
+	uint32_t inplace_period_bytes;	/* buffer bytes not touched per period */
+
+	/* buffer planning */
+	uint32_t complete;		/* construction complete and planned */
+	uint32_t scratch_bytes;		/* buffer memory in scratch pool */
+	uint32_t scratch_size;		/* scratch pool bytes used */
+
+	/* stream start */
+	uint32_t trigger_time;		/* time of last trigger start */
+	uint32_t start_latency;		/* trigger start to first sample in us */
 };
 
+/* is pipeline scheduled by timer */
+#define pipeline_is_timer(p) \
+	((p)->ipc_pipe.flags & SOF_IPC_PIPE_FLAG_TIMER)
+
+/* is pipeline scheduled by FIFO fill level */
+#define pipeline_is_fifo(p) \
+	((p)->ipc_pipe.flags & SOF_IPC_PIPE_FLAG_FIFO)
+
 /* static pipeline */
 extern struct pipeline *pipeline_static;
 
@@ -73,6 +110,12 @@ extern struct pipeline *pipeline_static;
 struct pipeline *pipeline_new(struct sof_ipc_pipe_new *pipe_desc);
 void pipeline_free(struct pipeline *p);
 
+/* plan buffer memory when pipeline construction is complete */
+int pipeline_complete(struct pipeline *p);
+
+/* release buffer from scratch pool */
+void pipeline_scratch_put(struct comp_buffer *buffer);
+
 /* pipeline buffer creation and destruction */
 struct comp_buffer *buffer_new(struct sof_ipc_buffer *desc);
 void buffer_free(struct comp_buffer *buffer);
@@ -108,8 +151,14 @@ int init_static_pipeline(struct ipc *ipc);
 /* pipeline creation */
 int init_pipeline(void);
 
-void pipeline_schedule_copy(struct pipeline *p, struct comp_dev *dev,
-		uint32_t deadline, uint32_t priority);
+int pipeline_schedule_copy(struct pipeline *p, struct comp_dev *dev,
+		uint32_t deadline, int32_t priority);
+
+/* align timer scheduled pipeline to DAI DMA IRQ */
+void pipeline_timer_align(struct pipeline *p);
+
+/* DAI has started, measure trigger start latency */
+void pipeline_first_sample(struct pipeline *p);
 
 void pipeline_schedule(void *arg);
 
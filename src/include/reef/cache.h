@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Intel Corporation nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: agent <agent@local>
+ *
+ * Batched data cache maintenance. Regions are rounded out to whole cache
+ * lines and merged with overlapping or adjacent regions in the batch, so a
+ * line shared by two periods or buffers is only written back or invalidated
+ * once. Regions in uncached memory are dropped.
+ */
+
+#ifndef __INCLUDE_CACHE__
+#define __INCLUDE_CACHE__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/cache.h>
+
+/* batch operations */
+#define DCACHE_WRITEBACK		0
+#define DCACHE_INVALIDATE		1
+#define DCACHE_WRITEBACK_INVALIDATE	2
+
+/* separate regions held before the batch is flushed */
+#define DCACHE_BATCH_REGIONS		4
+
+struct dcache_region {
+	uint32_t start;		/* cache line aligned */
+	uint32_t end;		/* cache line aligned, exclusive */
+};
+
+struct dcache_batch {
+	uint32_t op;		/* DCACHE_ */
+	uint32_t count;		/* regions in use */
+	struct dcache_region region[DCACHE_BATCH_REGIONS];
+};
+
+static inline void dcache_batch_init(struct dcache_batch *batch, uint32_t op)
+{
+	batch->op = op;
+	batch->count = 0;
+}
+
+/* add region, or region of ring buffer [addr, end) that may wrap */
+void dcache_batch_add(struct dcache_batch *batch, void *ptr, size_t size);
+void dcache_batch_add_ring(struct dcache_batch *batch, void *ptr, size_t size,
+	void *addr, void *end);
+
+/* run the operation on all regions and empty the batch */
+void dcache_batch_flush(struct dcache_batch *batch);
+
+/* single operation on region of ring buffer */
+static inline void dcache_ring_region(uint32_t op, void *ptr, size_t size,
+	void *addr, void *end)
+{
+	struct dcache_batch batch;
+
+	dcache_batch_init(&batch, op);
+	dcache_batch_add_ring(&batch, ptr, size, addr, end);
+	dcache_batch_flush(&batch);
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Intel Corporation nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#ifndef __INCLUDE_DMA_TRACE__
+#define __INCLUDE_DMA_TRACE__
+
+#include <stdint.h>
+#include <reef/dma.h>
+#include <reef/work.h>
+
+/* trace ring size must be a multiple of the block size and power of 2 */
+#define DMA_TRACE_RING_SIZE	0x2000
+#define DMA_TRACE_RING_WORDS	(DMA_TRACE_RING_SIZE >> 2)
+#define DMA_TRACE_BLOCK_SIZE	0x400	/* bytes copied to host per DMA */
+#define DMA_TRACE_US		500	/* drain period whilst blocks are full */
+#define DMA_TRACE_HOST_PAGES	16	/* max host buffer pages */
+
+/* trace ring - written by one core only */
+struct dma_trace_ring {
+	uint32_t *addr;		/* ring buffer in DRAM */
+	uint32_t w_pos;		/* bytes written - free running */
+	uint32_t r_pos;		/* bytes copied to host - free running */
+	uint32_t dropped;	/* records dropped as ring was full */
+	uint32_t messages;	/* records written to ring */
+};
+
+struct dma_trace_data {
+	struct dma_trace_ring ring;
+
+	/* local DMA config */
+	struct dma *dma;
+	int chan;
+	struct dma_sg_config config;
+	struct dma_sg_elem elem;
+	uint32_t copy_pending;	/* DMA copy in progress */
+
+	/* host buffer */
+	struct dma_sg_config host_sg;
+	uint32_t host_offset;
+	uint32_t host_size;
+	uint32_t enabled;	/* host buffer is ready */
+
+	struct work dmat_work;
+};
+
+int dma_trace_init(void);
+/* host SG elems are moved to the trace and must not be freed */
+int dma_trace_enable(struct dma_sg_config *host_sg, uint32_t host_size);
+int dma_trace_event(uint32_t *words, uint32_t count);
+
+#endif
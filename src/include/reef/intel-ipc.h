@@ -32,6 +32,7 @@
 #define __INCLUDE_INTEL_IPC_H__
 
 #include <stdint.h>
+#include <uapi/ipc.h>
 
 /* private data for IPC */
 struct intel_ipc_data {
@@ -45,5 +46,6 @@ struct intel_ipc_data {
 };
 
 int ipc_cmd(void);
+int ipc_cmd_is_posted(struct sof_ipc_hdr *hdr);
 
 #endif
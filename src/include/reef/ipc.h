@@ -48,6 +48,12 @@ struct reef;
 #define trace_ipc_error(__e)	trace_error(TRACE_CLASS_IPC, __e)
 
 #define MSG_QUEUE_SIZE		12
+#define HOST_MSG_QUEUE_SIZE	4	/* must be power of 2 */
+#define IPC_BULK_MAX_SIZE	4096	/* max size of DMA bulk command */
+
+/* component, buffer and pipeline ID hash - one bucket per expected ID */
+#define IPC_ID_HASH_SIZE	PLATFORM_MAX_TPLG_IDS
+#define ipc_id_hash(id)		((id) & (IPC_ID_HASH_SIZE - 1))
 
 
 /* IPC generic component device */
@@ -60,6 +66,7 @@ struct ipc_comp_dev {
 
 	/* lists */
 	struct list_item list;		/* list in components */
+	struct ipc_comp_dev *hash_next;	/* next in ID hash bucket */
 };
 
 /* IPC buffer device */
@@ -71,6 +78,7 @@ struct ipc_buffer_dev {
 
 	/* lists */
 	struct list_item list;		/* list in buffers */
+	struct ipc_buffer_dev *hash_next;	/* next in ID hash bucket */
 };
 
 /* IPC pipeline device */
@@ -82,6 +90,7 @@ struct ipc_pipeline_dev {
 
 	/* lists */
 	struct list_item list;		/* list in pipelines */
+	struct ipc_pipeline_dev *hash_next;	/* next in ID hash bucket */
 };
 
 struct ipc_msg {
@@ -95,11 +104,16 @@ struct ipc_msg {
 	void *cb_data;
 };
 
+/* host command copied from the inbox and queued for processing */
+struct ipc_host_msg {
+	uint32_t header;	/* specific to platform */
+	uint8_t data[SOF_IPC_MSG_MAX_SIZE];	/* inbox payload */
+};
+
 struct ipc {
 	/* messaging */
-	uint32_t host_msg;		/* current message from host */
 	struct ipc_msg *dsp_msg;		/* current message to host */
-	uint32_t host_pending;
+	uint32_t host_pending;		/* host commands in queue */
 	uint32_t dsp_pending;
 	struct list_item msg_list;
 	struct list_item empty_list;
@@ -107,6 +121,32 @@ struct ipc {
 	struct ipc_msg message[MSG_QUEUE_SIZE];
 	void *comp_data;
 
+	/* host command queue */
+	struct ipc_host_msg host_queue[HOST_MSG_QUEUE_SIZE];
+	uint32_t host_head;		/* next command to process */
+	uint32_t host_tail;		/* next free command slot */
+	uint32_t host_ack_pending;	/* host is waiting for DONE */
+	uint32_t host_ack_idx;		/* command to process before DONE */
+
+	/* posted command errors */
+	uint32_t posted_errors;		/* failed posted commands */
+	uint32_t posted_last_cmd;	/* last failed posted command */
+	int32_t posted_last_error;	/* last posted command error */
+
+	/* stream position table */
+	uint32_t posn_used;		/* bitmap of used table entries */
+	uint32_t posn_notify;		/* bitmap of entries to notify */
+	uint32_t posn_xrun;		/* bitmap of entries with xrun */
+
+	/* buffer health */
+	uint32_t buffer_xrun;		/* buffers have xrun to notify */
+
+	/* DSP wakeups from idle */
+	uint32_t wake_count;		/* total wakeups */
+	uint32_t wake_window;		/* wakeups in current second */
+	uint32_t wake_rate;		/* wakeups in last complete second */
+	uint32_t wake_start;		/* start of current second in ticks */
+
 	/* RX call back */
 	int (*cb)(struct ipc_msg *msg);
 
@@ -115,6 +155,11 @@ struct ipc {
 	struct list_item comp_list;		/* list of component devices */
 	struct list_item buffer_list;	/* list of buffer devices */
 
+	/* ID hash of pipelines, components and buffers */
+	struct ipc_pipeline_dev *pipeline_hash[IPC_ID_HASH_SIZE];
+	struct ipc_comp_dev *comp_hash[IPC_ID_HASH_SIZE];
+	struct ipc_buffer_dev *buffer_hash[IPC_ID_HASH_SIZE];
+
 	void *private;
 };
 
@@ -130,8 +175,23 @@ void ipc_free(struct ipc *ipc);
 
 int ipc_process_msg_queue(void);
 
+/* DSP has woken from idle */
+void ipc_pm_wakeup(void);
+
 int ipc_stream_send_notification(struct comp_dev *cdev,
 		struct sof_ipc_stream_posn *posn);
+
+/*
+ * Stream position table in shared memory.
+ */
+int ipc_stream_posn_get(uint32_t comp_id);
+void ipc_stream_posn_put(int entry);
+void ipc_stream_posn_update(int entry, uint32_t host_posn, int notify,
+	int xrun);
+
+/* buffer has xrun - notify host */
+void ipc_buffer_xrun(void);
+
 int ipc_queue_host_message(struct ipc *ipc, uint32_t header,
 	void *tx_data, size_t tx_bytes, void *rx_data,
 	size_t rx_bytes, void (*cb)(void*, void*), void *cb_data);
@@ -157,6 +217,7 @@ void ipc_buffer_free(struct ipc *ipc, uint32_t buffer_id);
  */
 int ipc_pipeline_new(struct ipc *ipc, struct sof_ipc_pipe_new *pipeline);
 void ipc_pipeline_free(struct ipc *ipc, uint32_t pipeline_id);
+int ipc_pipeline_complete(struct ipc *ipc, uint32_t pipeline_id);
 
 /*
  * Pipeline component and buffer connections.
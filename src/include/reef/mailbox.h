@@ -59,6 +59,18 @@
 #define mailbox_get_debug_base() \
 	MAILBOX_DEBUG_BASE
 
+#define mailbox_get_trace_base() \
+	MAILBOX_TRACE_BASE
+
+#define mailbox_get_trace_size() \
+	MAILBOX_TRACE_SIZE
+
+#define mailbox_get_control_base() \
+	MAILBOX_CONTROL_BASE
+
+#define mailbox_get_control_size() \
+	MAILBOX_CONTROL_SIZE
+
 #define mailbox_get_debug_size() \
 	MAILBOX_DEBUG_SIZE
 
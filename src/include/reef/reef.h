@@ -46,6 +46,11 @@ struct ipc;
 	({const typeof(((type *)0)->member) *__memberptr = (ptr); \
 	(type *)((char *)__memberptr - offsetof(type, member));})
 
+/* hot code and data are linked together at the start of the fastest memory */
+#define __hot_text	__attribute__((section(".text.hot")))
+#define __hot_data	__attribute__((section(".data.hot")))
+#define __hot_bss	__attribute__((section(".bss.hot")))
+
 /* C memcpy for arch that dont have arch_memcpy() */
 void cmemcpy(void *dest, void *src, size_t size);
 
@@ -52,6 +52,16 @@ struct reef;
 #define TASK_PRI_MED	0
 #define TASK_PRI_HIGH	-20
 
+/*
+ * Task priority levels - each level runs on its own IRQ so tasks at a higher
+ * level preempt tasks at lower levels. Tasks within a level are run in EDF
+ * order.
+ */
+#define TASK_LEVEL_LOW	0
+#define TASK_LEVEL_MED	1
+#define TASK_LEVEL_HIGH	2
+#define TASK_LEVELS	3
+
 struct task {
 	uint16_t core;			/* core id to run on */
 	int16_t priority;		/* scheduling priority TASK_PRI_ */
@@ -59,6 +69,18 @@ struct task {
 	uint32_t max_rtime;		/* max time taken to run */
 	uint32_t state;			/* TASK_STATE_ */
 	struct list_item list;		/* list in scheduler */
+
+	/* statistics */
+	uint32_t release;		/* time task was queued */
+	uint32_t max_response;		/* max time from queued to complete */
+	uint32_t preemptions;		/* times preempted by higher level */
+	uint32_t deadline_misses;	/* times completed after deadline */
+
+	/* admission control */
+	uint32_t period;		/* period in us, 0 if not configured */
+	uint32_t budget;		/* declared run time per period in us */
+	struct list_item admit_list;	/* list of admitted tasks */
+
 	void *data;
 	void *sdata;
 	void (*func)(void *arg);
@@ -66,14 +88,38 @@ struct task {
 
 void schedule(void);
 
-void schedule_task(struct task *task, uint32_t deadline, uint16_t priority,
+int schedule_task(struct task *task, uint32_t deadline, int16_t priority,
 		void *data);
 
 void schedule_task_core(struct task *task, uint32_t deadline,
-	uint16_t priority, uint16_t core, void *data);
+	int16_t priority, uint16_t core, void *data);
+
+void schedule_task_running(struct task *task);
 
 void schedule_task_complete(struct task *task);
 
+/* admission control */
+int schedule_task_config(struct task *task, uint32_t period, uint32_t mips);
+int schedule_task_admit(struct task *task);
+void schedule_task_release(struct task *task);
+void schedule_task_rtime(struct task *task, uint32_t ticks);
+uint32_t schedule_utilisation(void);
+uint32_t schedule_utilisation_max(void);
+
+/* priority level of task */
+static inline int task_get_level(struct task *task)
+{
+	switch (task->priority) {
+	case TASK_PRI_MED + 1 ... TASK_PRI_LOW:
+		return TASK_LEVEL_LOW;
+	case TASK_PRI_HIGH ... TASK_PRI_MED - 1:
+		return TASK_LEVEL_HIGH;
+	case TASK_PRI_MED:
+	default:
+		return TASK_LEVEL_MED;
+	}
+}
+
 static inline void task_init(struct task *task, void (*func)(void *),
 	void *data)
 {
@@ -83,6 +129,13 @@ static inline void task_init(struct task *task, void (*func)(void *),
 	task->func = func;
 	task->data = data;
 	task->sdata = NULL;
+	task->max_rtime = 0;
+	task->max_response = 0;
+	task->preemptions = 0;
+	task->deadline_misses = 0;
+	task->period = 0;
+	task->budget = 0;
+	list_init(&task->admit_list);
 }
 
 int scheduler_init(struct reef *reef);
@@ -65,7 +65,17 @@
 #define TRACE_BOOT_PLATFORM_SSP		(TRACE_BOOT_PLATFORM + 0x108)
 
 
-/* trace event classes - high 8 bits*/
+/*
+ * Trace records are a timestamp and an event followed by up to four args.
+ * Events are the class in bits 24 - 28, number of args in bits 29 - 31 and
+ * a three character event ID in bits 0 - 23. Values are records with the
+ * reserved class 0 and the value as their only arg.
+ */
+#define TRACE_ARGS_SHIFT	29
+#define TRACE_ARGS_MAX		4
+#define TRACE_VALUE_EVENT	(1 << TRACE_ARGS_SHIFT)
+
+/* trace event classes - bits 24 - 28 */
 #define TRACE_CLASS_IRQ		(1 << 24)
 #define TRACE_CLASS_IPC		(2 << 24)
 #define TRACE_CLASS_PIPE	(3 << 24)
@@ -86,47 +96,128 @@
 #define TRACE_CLASS_TONE        (18 << 24)
 #define TRACE_CLASS_EQ_FIR      (19 << 24)
 #define TRACE_CLASS_EQ_IIR      (20 << 24)
+#define TRACE_CLASS_CONVERT	(21 << 24)
+
+/* class bitmap for runtime filtering */
+#define TRACE_CLASS_BIT(__c)	(1 << (((__c) >> 24) & 0x1f))
+#define TRACE_CLASS_ALL		0xffffffff
+
+/* trace levels - each level has a runtime class bitmap */
+#define TRACE_LEVEL_ERROR	0
+#define TRACE_LEVEL_INFO	1
+#define TRACE_LEVEL_VERBOSE	2
+#define TRACE_LEVELS		3
 
 /* move to config.h */
 #define TRACE	1
-#define TRACEV	0
+#define TRACEV	1
 #define TRACEE	1
 
+extern uint32_t trace_mask[TRACE_LEVELS];
+extern uint32_t trace_values;
+
 void _trace_event(uint32_t event);
+void _trace_value(uint32_t value);
+void _trace_event_args(uint32_t event, uint32_t nargs, uint32_t a0,
+	uint32_t a1, uint32_t a2, uint32_t a3);
+int trace_set_filter(uint32_t level, uint32_t mask);
 void trace_off(void);
 
 #if TRACE
 
-#define trace_event(__c, __e) \
-	_trace_event(__c | (__e[0] << 16) | (__e[1] <<8) | __e[2])
-
-#define trace_value(x)	_trace_event(x)
+#define trace_id(__c, __e) \
+	(__c | (__e[0] << 16) | (__e[1] <<8) | __e[2])
+
+/* class and level are constants so the filter is a single branch */
+#define trace_enabled(__c, __l) \
+	(trace_mask[__l] & TRACE_CLASS_BIT(__c))
+
+/* values that follow a filtered event are filtered with it */
+#define _trace_level(__c, __l, __e) \
+	do { \
+		if (trace_enabled(__c, __l)) \
+			_trace_event(trace_id(__c, __e)); \
+		else \
+			trace_values = 0; \
+	} while (0)
+
+#define _trace_level_args(__c, __l, __e, __n, __a0, __a1, __a2, __a3) \
+	do { \
+		if (trace_enabled(__c, __l)) \
+			_trace_event_args(trace_id(__c, __e), __n, \
+				(uint32_t)(__a0), (uint32_t)(__a1), \
+				(uint32_t)(__a2), (uint32_t)(__a3)); \
+		else \
+			trace_values = 0; \
+	} while (0)
+
+#define trace_event(__c, __e) _trace_level(__c, TRACE_LEVEL_INFO, __e)
+
+/* single record with event and args */
+#define trace_event1(__c, __e, __a0) \
+	_trace_level_args(__c, TRACE_LEVEL_INFO, __e, 1, __a0, 0, 0, 0)
+#define trace_event2(__c, __e, __a0, __a1) \
+	_trace_level_args(__c, TRACE_LEVEL_INFO, __e, 2, __a0, __a1, 0, 0)
+#define trace_event3(__c, __e, __a0, __a1, __a2) \
+	_trace_level_args(__c, TRACE_LEVEL_INFO, __e, 3, __a0, __a1, __a2, 0)
+#define trace_event4(__c, __e, __a0, __a1, __a2, __a3) \
+	_trace_level_args(__c, TRACE_LEVEL_INFO, __e, 4, __a0, __a1, __a2, __a3)
+
+#define trace_value(x) \
+	do { \
+		if (trace_values) \
+			_trace_value(x); \
+	} while (0)
 
 #define trace_point(x) platform_trace_point(x)
 
 /* verbose tracing */
 #if TRACEV
-#define tracev_event(__c, __e) trace_event(__c, __e)
-#define tracev_value(x)	_trace_event(x)
+#define tracev_event(__c, __e) _trace_level(__c, TRACE_LEVEL_VERBOSE, __e)
+#define tracev_event1(__c, __e, __a0) \
+	_trace_level_args(__c, TRACE_LEVEL_VERBOSE, __e, 1, __a0, 0, 0, 0)
+#define tracev_event2(__c, __e, __a0, __a1) \
+	_trace_level_args(__c, TRACE_LEVEL_VERBOSE, __e, 2, __a0, __a1, 0, 0)
+#define tracev_value(x) \
+	do { \
+		if (trace_mask[TRACE_LEVEL_VERBOSE] && trace_values) \
+			_trace_value(x); \
+	} while (0)
 #else
 #define tracev_event(__c, __e)
+#define tracev_event1(__c, __e, __a0)
+#define tracev_event2(__c, __e, __a0, __a1)
 #define tracev_value(x)
 #endif
 
 /* error tracing */
 #if TRACEE
-#define trace_error(__c, __e) trace_event(__c, __e)
+#define trace_error(__c, __e) _trace_level(__c, TRACE_LEVEL_ERROR, __e)
+#define trace_error1(__c, __e, __a0) \
+	_trace_level_args(__c, TRACE_LEVEL_ERROR, __e, 1, __a0, 0, 0, 0)
+#define trace_error2(__c, __e, __a0, __a1) \
+	_trace_level_args(__c, TRACE_LEVEL_ERROR, __e, 2, __a0, __a1, 0, 0)
 #else
 #define trace_error(__c, __e)
+#define trace_error1(__c, __e, __a0)
+#define trace_error2(__c, __e, __a0, __a1)
 #endif
 
 #else
 
 #define trace_event(x, e)
+#define trace_event1(c, e, a0)
+#define trace_event2(c, e, a0, a1)
+#define trace_event3(c, e, a0, a1, a2)
+#define trace_event4(c, e, a0, a1, a2, a3)
 #define trace_error(c, e)
+#define trace_error1(c, e, a0)
+#define trace_error2(c, e, a0, a1)
 #define trace_value(x)
 #define trace_point(x)
 #define tracev_event(__c, __e)
+#define tracev_event1(__c, __e, __a0)
+#define tracev_event2(__c, __e, __a0, __a1)
 #define tracev_value(x)
 
 #endif
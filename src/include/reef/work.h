@@ -49,7 +49,7 @@ struct work {
 	void *cb_data;
 	struct list_item list;
 	uint32_t timeout;
-	uint32_t pending;
+	uint32_t pending;	/* work is queued or running */
 	uint32_t flags;
 };
 
@@ -66,7 +66,9 @@ struct work_queue_timesource {
 #define work_init(w, x, xd, xflags) \
 	(w)->cb = x; \
 	(w)->cb_data = xd; \
-	(w)->flags = xflags;
+	(w)->flags = xflags; \
+	(w)->pending = 0; \
+	list_init(&(w)->list);
 
 /* schedule/cancel work on work queue */
 void work_schedule(struct work_queue *queue, struct work *w, uint32_t timeout);
@@ -62,6 +62,8 @@
 #define SOF_IPC_GLB_COMP_MSG			SOF_GLB_TYPE(0x5)
 #define SOF_IPC_GLB_STREAM_MSG			SOF_GLB_TYPE(0x6)
 #define SOF_IPC_FW_READY			SOF_GLB_TYPE(0x7)
+#define SOF_IPC_GLB_BULK			SOF_GLB_TYPE(0x8)
+#define SOF_IPC_GLB_TRACE_MSG			SOF_GLB_TYPE(0x9)
 
 /*
  * DSP Command Message Types
@@ -79,6 +81,7 @@
 #define SOF_IPC_TPLG_PIPE_FREE			SOF_CMD_TYPE(0x011)
 #define SOF_IPC_TPLG_PIPE_CONNECT		SOF_CMD_TYPE(0x012)
 #define SOF_IPC_TPLG_PIPE_COMPLETE		SOF_CMD_TYPE(0x013)
+#define SOF_IPC_TPLG_PIPE_STATUS		SOF_CMD_TYPE(0x014)
 #define SOF_IPC_TPLG_BUFFER_NEW			SOF_CMD_TYPE(0x020)
 #define SOF_IPC_TPLG_BUFFER_FREE		SOF_CMD_TYPE(0x021)
 
@@ -89,6 +92,7 @@
 #define SOF_IPC_PM_CLK_SET			SOF_CMD_TYPE(0x003)
 #define SOF_IPC_PM_CLK_GET			SOF_CMD_TYPE(0x004)
 #define SOF_IPC_PM_CLK_REQ			SOF_CMD_TYPE(0x005)
+#define SOF_IPC_PM_WAKE_STATS			SOF_CMD_TYPE(0x006)
 
 /* component - multiple different types */
 #define SOF_IPC_COMP_SET_VOLUME			SOF_CMD_TYPE(0x000)
@@ -115,9 +119,18 @@
 #define SOF_IPC_STREAM_TRIG_DRAIN		SOF_CMD_TYPE(0x008)
 #define SOF_IPC_STREAM_TRIG_XRUN		SOF_CMD_TYPE(0x009)
 #define SOF_IPC_STREAM_POSITION			SOF_CMD_TYPE(0x00a)
+#define SOF_IPC_STREAM_BUFFER_STATUS		SOF_CMD_TYPE(0x00b)
+#define SOF_IPC_STREAM_POSN_PARAMS		SOF_CMD_TYPE(0x00c)
+#define SOF_IPC_STREAM_POSN_NOTIFY		SOF_CMD_TYPE(0x00d)
 #define SOF_IPC_STREAM_VORBIS_PARAMS		SOF_CMD_TYPE(0x010)
 #define SOF_IPC_STREAM_VORBIS_FREE		SOF_CMD_TYPE(0x011)
 
+/* trace */
+#define SOF_IPC_TRACE_DMA_PARAMS		SOF_CMD_TYPE(0x001)
+#define SOF_IPC_TRACE_DMA_POSITION		SOF_CMD_TYPE(0x002)
+#define SOF_IPC_TRACE_FILTER			SOF_CMD_TYPE(0x003)
+#define SOF_IPC_TRACE_POSTED_STATUS		SOF_CMD_TYPE(0x004)
+
 
 /* Get message component id */
 #define SOF_IPC_MESSAGE_ID(x)			(x & 0xffff)
@@ -151,6 +164,18 @@ struct sof_ipc_compound_hdr {
 	uint32_t count;			/* count of 0 means end of compound sequence */
 }  __attribute__((packed));
 
+/*
+ * Compound reply - one reply is sent for the whole compound sequence.
+ *
+ * Commands are processed in order and processing stops at the first command
+ * that fails. Any reply data from individual commands is not returned.
+ */
+struct sof_ipc_compound_reply {
+	struct sof_ipc_hdr hdr;
+	int32_t error;			/* error from failed command or 0 */
+	uint32_t count;			/* number of commands completed */
+}  __attribute__((packed));
+
 
 /*
  * DAI Configuration.
@@ -282,6 +307,7 @@ enum sof_ipc_frame {
 	SOF_IPC_FRAME_S16_LE = 0,
 	SOF_IPC_FRAME_S24_4LE,
 	SOF_IPC_FRAME_S32_LE,
+	SOF_IPC_FRAME_S24_3LE,
 	/* other formats here */
 };
 
@@ -306,6 +332,20 @@ struct sof_ipc_host_buffer {
 	uint32_t offset;
 } __attribute__((packed));
 
+/*
+ * Bulk commands - SOF_IPC_GLB_BULK.
+ *
+ * Commands larger than the mailbox are placed in host pages and only this
+ * descriptor is sent in the mailbox. The DSP copies the command by DMA using
+ * the page table at buffer.phy_addr and then processes it as if it had been
+ * sent in the mailbox. buffer.size is the size of the command in bytes and
+ * buffer.offset is the offset of the command in the first page.
+ */
+struct sof_ipc_bulk {
+	struct sof_ipc_hdr hdr;
+	struct sof_ipc_host_buffer buffer;
+}  __attribute__((packed));
+
 
 /* PCM params info - SOF_IPC_STREAM_PCM_PARAMS */
 struct sof_ipc_pcm_params {
@@ -356,6 +396,60 @@ struct sof_ipc_stream_posn {
 	uint64_t timestamp;
 }  __attribute__((packed));
 
+/*
+ * Stream position table.
+ *
+ * The DSP writes the position of each host PCM to a table in the mailbox
+ * stream region every period. The host can read positions at any time
+ * without IPC. The DSP increments seq before and after each update so seq is
+ * odd whilst the entry is being written. Entries with seq of 0 are unused.
+ */
+struct sof_ipc_stream_posn_entry {
+	uint32_t seq;			/* odd whilst DSP is writing */
+	uint32_t comp_id;		/* host component */
+	uint32_t host_posn;		/* in bytes */
+	uint32_t xrun_count;		/* number of host buffer xruns */
+	uint64_t timestamp;		/* DSP wall clock ticks */
+}  __attribute__((packed));
+
+/* position notification interval - SOF_IPC_STREAM_POSN_PARAMS */
+struct sof_ipc_stream_posn_params {
+	struct sof_ipc_hdr hdr;
+	uint32_t comp_id;		/* host component */
+	uint32_t notify_bytes;		/* IPC interval, 0 every period */
+}  __attribute__((packed));
+
+/*
+ * Batched position notification - SOF_IPC_STREAM_POSN_NOTIFY.
+ *
+ * One notification is sent for all streams that reached their position
+ * notification interval or had an xrun since the last notification. Each
+ * bit is the index of a position table entry.
+ */
+struct sof_ipc_stream_posn_notify {
+	struct sof_ipc_hdr hdr;
+	uint32_t entries;		/* entries with new position */
+	uint32_t xrun;			/* entries with xrun */
+}  __attribute__((packed));
+
+/*
+ * Buffer status - SOF_IPC_STREAM_BUFFER_STATUS.
+ *
+ * Sent by the host with buffer_id to query a buffer and sent by the DSP
+ * when a buffer has an xrun. Water marks are in bytes and are the highest
+ * and lowest fill level seen since the buffer was created.
+ */
+struct sof_ipc_buffer_status {
+	struct sof_ipc_hdr hdr;
+	uint32_t buffer_id;
+	uint32_t size;			/* in bytes */
+	uint32_t underruns;
+	uint32_t overruns;
+	uint32_t high_water;		/* in bytes */
+	uint32_t low_water;		/* in bytes */
+	uint64_t last_xrun;		/* DSP wall clock ticks */
+}  __attribute__((packed));
+
 /*
  * Component Mixers and Controls
  */
@@ -372,6 +466,25 @@ struct sof_ipc_ctrl_values {
 	struct sof_ipc_ctrl_chan values[SOF_IPC_MAX_CHANNELS];
 } __attribute__((packed));
 
+/*
+ * Shared memory volume control.
+ *
+ * The host writes volume directly into slots in the mailbox control region
+ * without sending IPC and the DSP reads each slot once per period. The host
+ * increments seq before and after each update so seq is odd whilst the slot
+ * is being written. Slots with seq of 0 are unused. Slots are looked up when
+ * the stream is prepared, and slots set up whilst the stream is running are
+ * only looked up after the next volume or mute IPC for the component.
+ */
+#define SOF_IPC_MMAP_VOL_MUTE			(1 << 31)
+
+struct sof_ipc_ctrl_mmap_vol {
+	uint32_t seq;			/* odd whilst host is writing */
+	uint16_t comp_id;		/* volume component */
+	uint16_t channel;		/* enum sof_ipc_chmap */
+	uint32_t value;			/* volume or SOF_IPC_MMAP_VOL_MUTE */
+} __attribute__((packed));
+
 struct sof_ipc_ctrl_get_values {
 	struct sof_ipc_hdr hdr;
 	uint32_t comp_id;
@@ -401,6 +514,7 @@ enum sof_comp_type {
 	SOF_COMP_EQ_FIR,
         SOF_COMP_FILEREAD,      /* For test bench only */
         SOF_COMP_FILEWRITE,     /* For test bench only */
+	SOF_COMP_CONVERT,
 };
 
 /* create new generic component - SOF_IPC_TPLG_COMP_NEW */
@@ -499,6 +613,17 @@ struct sof_ipc_comp_mux {
 	struct sof_ipc_pcm_comp pcm;
 } __attribute__((packed));
 
+/*
+ * Format and channel converter component. Source and sink frame formats are
+ * negotiated by the pipeline. Channels are converted by duplicating mono,
+ * averaging to mono, or dropping/zeroing the extra channels.
+ */
+struct sof_ipc_comp_convert {
+	struct sof_ipc_comp comp;
+	struct sof_ipc_pcm_comp pcm;
+	uint32_t sink_channels;	/* channels on sink, 0 to keep source */
+} __attribute__((packed));
+
 /* generic tone generator component */
 struct sof_ipc_comp_tone {
 	struct sof_ipc_comp comp;
@@ -568,7 +693,10 @@ struct sof_ipc_comp_reply {
  * Pipeline
  */
 
-/* new pipeline - SOF_IPC_TPLG_PIPE_NEW */
+/*
+ * new pipeline - SOF_IPC_TPLG_PIPE_NEW
+ * Fields after mips are optional and default to 0 if hdr.size excludes them.
+ */
 struct sof_ipc_pipe_new {
 	struct sof_ipc_hdr hdr;
 	uint32_t comp_id;	/* component at start of pipeline */ 
@@ -577,6 +705,71 @@ struct sof_ipc_pipe_new {
 	uint32_t deadline;	/* execution completion deadline in us*/
 	uint32_t priority;	/* priority level 0 (low) to 10 (max) */
 	uint32_t mips;		/* worst case instruction count per period */
+	uint32_t period_frames;	/* frames per period, 0 for platform default */
+	uint32_t flags;		/* SOF_IPC_PIPE_FLAG_ */
+	uint32_t dma_periods;	/* DAI DMA periods per IRQ in timer mode */
+}  __attribute__((packed));
+
+/* max pipeline priority - higher priority pipelines preempt lower ones */
+#define SOF_IPC_PIPE_PRI_MAX		10
+
+/*
+ * Deep buffer pipelines are for low power playback. The host component
+ * copies half of its buffer per host DMA so the host link, position updates
+ * and DMA waits are idle between refills. The rest of the pipeline still
+ * processes one period at a time. The host component buffer must hold at
+ * least two refills of the platform minimum deep buffer periods.
+ */
+#define SOF_IPC_PIPE_FLAG_DEEP_BUFFER	(1 << 0)
+
+/*
+ * Timer pipelines are scheduled by the DSP timer every period instead of by
+ * DAI DMA IRQs, so pipelines without a DAI can run. The timer is aligned to
+ * the DAI DMA IRQ when there is a DAI, and the DAI only raises an IRQ every
+ * dma_periods periods.
+ */
+#define SOF_IPC_PIPE_FLAG_TIMER		(1 << 1)
+
+/*
+ * FIFO pipelines are scheduled by the fill level of the buffers connecting
+ * them to other pipelines, so each side runs at its own period. A FIFO
+ * pipeline writing to a buffer runs when a period of its own fits, and one
+ * reading from a buffer runs when a period of its own is available. The
+ * buffer must hold at least one period of each pipeline.
+ */
+#define SOF_IPC_PIPE_FLAG_FIFO		(1 << 2)
+
+/*
+ * Scheduler admission reply - sent as the reply to SOF_IPC_TPLG_PIPE_NEW and
+ * SOF_IPC_STREAM_TRIG_START when the DSP does not have time to run the
+ * pipeline. Utilisation is in 1/1000 of DSP time.
+ */
+struct sof_ipc_sched_reply {
+	struct sof_ipc_hdr hdr;
+	int32_t error;
+	uint32_t utilisation;		/* current utilisation */
+	uint32_t utilisation_max;	/* admission bound */
+}  __attribute__((packed));
+
+/*
+ * Pipeline scheduling status - SOF_IPC_TPLG_PIPE_STATUS.
+ *
+ * Sent by the host with pipeline_id and returned by the DSP. Times are in
+ * DSP wall clock ticks. Response is the time from the pipeline task being
+ * queued to its completion.
+ */
+struct sof_ipc_pipe_status {
+	struct sof_ipc_hdr hdr;
+	uint32_t pipeline_id;
+	uint32_t max_rtime;		/* max run time */
+	uint32_t max_response;		/* max response time */
+	uint32_t preemptions;		/* times preempted by higher priority */
+	uint32_t deadline_misses;
+	uint32_t inplace_bytes;		/* buffer memory saved by in place */
+	uint32_t inplace_period_bytes;	/* buffer traffic saved per period */
+	uint32_t scratch_bytes;		/* buffer memory in scratch pool */
+	uint32_t scratch_size;		/* scratch pool bytes used */
+	uint32_t start_latency;		/* trigger start to first sample in us */
 }  __attribute__((packed));
 
 /* pipeline construction complete - SOF_IPC_TPLG_PIPE_COMPLETE */
@@ -632,6 +825,61 @@ struct sof_ipc_pm_ctx {
 	struct sof_ipc_pm_ctx_elem elems[];
 };
 
+/* DSP wakeups from idle - SOF_IPC_PM_WAKE_STATS */
+struct sof_ipc_pm_wake_stats {
+	struct sof_ipc_hdr hdr;
+	uint32_t wakeups;		/* total wakeups since boot */
+	uint32_t wakeups_per_sec;	/* wakeups in last complete second */
+}  __attribute__((packed));
+
+/*
+ * DMA trace - SOF_IPC_GLB_TRACE_MSG.
+ *
+ * The host provides a buffer described by a page table and the DSP copies
+ * trace events to it in blocks by DMA. The DSP writes the trace position to
+ * the mailbox trace region after each block is copied.
+ */
+
+/* SOF_IPC_TRACE_DMA_PARAMS */
+struct sof_ipc_dma_trace_params {
+	struct sof_ipc_hdr hdr;
+	struct sof_ipc_host_buffer buffer;
+} __attribute__((packed));
+
+/* SOF_IPC_TRACE_DMA_POSITION */
+struct sof_ipc_dma_trace_posn {
+	struct sof_ipc_hdr hdr;
+	uint32_t host_offset;	/* offset of next block in host buffer */
+	uint32_t overflow;	/* events dropped by DSP */
+	uint32_t messages;	/* events written by DSP */
+} __attribute__((packed));
+
+/*
+ * Trace filter - SOF_IPC_TRACE_FILTER.
+ *
+ * Each level is a bitmap of trace classes that are enabled at that level.
+ * Bit n is trace class n.
+ */
+struct sof_ipc_trace_filter {
+	struct sof_ipc_hdr hdr;
+	uint32_t error;		/* classes with error tracing */
+	uint32_t info;		/* classes with event tracing */
+	uint32_t verbose;	/* classes with verbose tracing */
+} __attribute__((packed));
+
+/*
+ * Posted command errors - SOF_IPC_TRACE_POSTED_STATUS.
+ *
+ * Posted commands are completed before they are processed so any error is
+ * counted here instead of being returned to the host.
+ */
+struct sof_ipc_posted_status {
+	struct sof_ipc_hdr hdr;
+	uint32_t errors;	/* posted commands that failed since boot */
+	uint32_t last_cmd;	/* header of last failed posted command */
+	int32_t last_error;	/* error of last failed posted command */
+} __attribute__((packed));
+
 /*
  * Firmware boot and version
  */
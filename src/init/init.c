@@ -78,6 +78,9 @@ int main(int argc, char *argv[])
 
 	trace_point(TRACE_BOOT_PLATFORM);
 
+	/* boot allocations are rebuilt on resume and not saved */
+	mm_pm_boot_complete();
+
 	/* should not return */
 	err = do_task(&reef);
 
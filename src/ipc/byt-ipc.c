@@ -85,7 +85,66 @@ out:
 	shim_write(SHIM_IMRD, shim_read(SHIM_IMRD) & ~SHIM_IMRD_DONE);
 }
 
-/* test code to check working IRQ */
+/* tell host we have completed the command and can accept new messages */
+static void ipc_host_ack(void)
+{
+	uint32_t ipcxh;
+
+	/* clear BUSY bit and set DONE bit - accept new messages */
+	ipcxh = shim_read(SHIM_IPCXH);
+	ipcxh &= ~SHIM_IPCXH_BUSY;
+	ipcxh |= SHIM_IPCXH_DONE;
+	shim_write(SHIM_IPCXH, ipcxh);
+
+	/* unmask busy interrupt */
+	shim_write(SHIM_IMRD, shim_read(SHIM_IMRD) & ~SHIM_IMRD_BUSY);
+}
+
+/* copy new host command from the inbox to the command queue */
+static void ipc_host_queue_msg(void)
+{
+	struct ipc_host_msg *msg;
+	struct sof_ipc_hdr *hdr;
+	uint32_t idx, size;
+
+	/* busy IRQ stays masked whilst queue is full so host can't send */
+	if (_ipc->host_pending == HOST_MSG_QUEUE_SIZE) {
+		trace_ipc_error("Pen");
+		return;
+	}
+
+	idx = _ipc->host_tail;
+	msg = &_ipc->host_queue[idx];
+	hdr = (struct sof_ipc_hdr *)msg->data;
+	msg->header = shim_read(SHIM_IPCXL);
+
+	/* read command, size is validated again when command is processed */
+	mailbox_inbox_read(hdr, 0, sizeof(*hdr));
+	if (hdr->size > sizeof(*hdr) && hdr->size <= SOF_IPC_MSG_MAX_SIZE) {
+		mailbox_inbox_read(hdr + 1, sizeof(*hdr),
+			hdr->size - sizeof(*hdr));
+		size = hdr->size;
+	} else
+		size = sizeof(*hdr);
+
+	/* don't leave an older command in the tail of the slot */
+	bzero(msg->data + size, SOF_IPC_MSG_MAX_SIZE - size);
+
+	_ipc->host_tail = (idx + 1) & (HOST_MSG_QUEUE_SIZE - 1);
+	_ipc->host_pending++;
+
+	/* posted commands complete now if there is room for another command */
+	if (ipc_cmd_is_posted(hdr) &&
+		_ipc->host_pending < HOST_MSG_QUEUE_SIZE) {
+		ipc_host_ack();
+		return;
+	}
+
+	/* otherwise complete when this command or oldest command is done */
+	_ipc->host_ack_pending = 1;
+	_ipc->host_ack_idx = ipc_cmd_is_posted(hdr) ? _ipc->host_head : idx;
+}
+
 static void irq_handler(void *arg)
 {
 	uint32_t isr;
@@ -109,32 +168,61 @@ static void irq_handler(void *arg)
 		shim_write(SHIM_IMRD, shim_read(SHIM_IMRD) | SHIM_IMRD_BUSY);
 		interrupt_clear(PLATFORM_IPC_INTERUPT);
 
-		/* TODO: place message in Q and process later */
-		/* It's not Q ATM, may overwrite */
-		if (_ipc->host_pending)
-			trace_ipc_error("Pen");
-		_ipc->host_msg = shim_read(SHIM_IPCXL);
-		_ipc->host_pending = 1;
+		/* place message in Q and process later */
+		ipc_host_queue_msg();
 	}
 }
 
 void ipc_platform_do_cmd(struct ipc *ipc)
 {
 	struct intel_ipc_data *iipc = ipc_get_drvdata(ipc);
-	uint32_t ipcxh;//, status;
+	struct ipc_host_msg *msg;
+	struct sof_ipc_hdr *hdr;
+	uint32_t flags, idx;
+	int ret;
 
 	trace_ipc("Cmd");
-	//trace_value(_ipc->host_msg);
 
-	/* TODO: handle error with reply data in mailbox */
-	ipc_cmd();
-	ipc->host_pending = 0;
+	spin_lock_irq(&ipc->lock, flags);
+
+	/* process all queued commands in order */
+	while (ipc->host_pending) {
+
+		/* command slot stays in use until command is complete */
+		idx = ipc->host_head;
+		msg = &ipc->host_queue[idx];
+		rmemcpy(ipc->comp_data, msg->data, SOF_IPC_MSG_MAX_SIZE);
+
+		spin_unlock_irq(&ipc->lock, flags);
+
+		/* TODO: handle error with reply data in mailbox */
+		ret = ipc_cmd();
+
+		spin_lock_irq(&ipc->lock, flags);
+
+		/* host has already been told posted commands are complete */
+		hdr = (struct sof_ipc_hdr *)msg->data;
+		if (ret < 0 && ipc_cmd_is_posted(hdr)) {
+			trace_ipc_error("ePo");
+			trace_value(hdr->cmd);
+			ipc->posted_errors++;
+			ipc->posted_last_cmd = hdr->cmd;
+			ipc->posted_last_error = ret;
+		}
+
+		ipc->host_head = (idx + 1) & (HOST_MSG_QUEUE_SIZE - 1);
+		ipc->host_pending--;
+
+		/* is host waiting for this command to complete ? */
+		if (ipc->host_ack_pending && ipc->host_ack_idx == idx) {
+			ipc->host_ack_pending = 0;
+			ipc_host_ack();
+		}
+	}
+
+	spin_unlock_irq(&ipc->lock, flags);
+
 	trace_ipc("CmD");
-	/* clear BUSY bit and set DONE bit - accept new messages */
-	ipcxh = shim_read(SHIM_IPCXH);
-	ipcxh &= ~SHIM_IPCXH_BUSY;
-	ipcxh |= SHIM_IPCXH_DONE;// | status;
-	shim_write(SHIM_IPCXH, ipcxh);
 
 	// TODO: signal audio work to enter D3 in normal context
 	/* are we about to enter D3 ? */
@@ -142,9 +230,6 @@ void ipc_platform_do_cmd(struct ipc *ipc)
 		while (1)
 			wait_for_interrupt(0);
 	}
-
-	/* unmask busy interrupt */
-	shim_write(SHIM_IMRD, shim_read(SHIM_IMRD) & ~SHIM_IMRD_BUSY);
 }
 
 void ipc_platform_send_msg(struct ipc *ipc)
@@ -64,6 +64,17 @@ static struct dma_sg_elem *sg_get_elem_at(struct dma_sg_config *host_sg,
 	return NULL;
 }
 
+static void dma_complete(void *data, uint32_t type, struct dma_sg_elem *next)
+{
+	completion_t *comp = (completion_t *)data;
+
+	if (type == DMA_IRQ_TYPE_LLIST)
+		wait_completed(comp);
+
+	/* each copy is a single transfer */
+	next->size = DMA_RELOAD_END;
+}
+
 int dma_copy_to_host(struct dma_sg_config *host_sg, int32_t host_offset,
 	void *local_ptr, int32_t size)
 {
@@ -76,6 +87,11 @@ int dma_copy_to_host(struct dma_sg_config *host_sg, int32_t host_offset,
 	if (dma == NULL)
 		return -ENODEV;
 
+	/* find host element with host_offset */
+	host_sg_elem = sg_get_elem_at(host_sg, &offset);
+	if (host_sg_elem == NULL)
+		return -EINVAL;
+
 	/* get DMA channel from DMAC0 */
 	chan = dma_channel_get(dma);
 	if (chan < 0) {
@@ -83,23 +99,20 @@ int dma_copy_to_host(struct dma_sg_config *host_sg, int32_t host_offset,
 		return chan;
 	}
 
-	/* find host element with host_offset */
-	host_sg_elem = sg_get_elem_at(host_sg, &offset);
-	if (host_sg_elem == NULL)
-		return -EINVAL;
-
 	/* set up DMA configuration */
-	complete.timeout = 100;	/* wait 100 usecs for DMA to finish */
 	config.direction = DMA_DIR_LMEM_TO_HMEM;
 	config.src_width = sizeof(uint32_t);
 	config.dest_width = sizeof(uint32_t);
 	config.cyclic = 0;
 	list_init(&config.elem_list);
+	dma_set_cb(dma, chan, DMA_IRQ_TYPE_LLIST, dma_complete, &complete);
 
-	/* configure local DMA elem */
+	/* configure local DMA elem, first copy is to end of host elem */
 	local_sg_elem.dest = host_sg_elem->dest + offset;
 	local_sg_elem.src = (uint32_t)local_ptr;
-	local_sg_elem.size = HOST_PAGE_SIZE - offset;
+	local_sg_elem.size = host_sg_elem->size - offset;
+	if (local_sg_elem.size > size)
+		local_sg_elem.size = size;
 	list_item_prepend(&local_sg_elem.list, &config.elem_list);
 
 	/* transfer max PAGE size at a time to SG buffer */
@@ -107,6 +120,7 @@ int dma_copy_to_host(struct dma_sg_config *host_sg, int32_t host_offset,
 
 		/* start the DMA */
 		wait_init(&complete);
+		complete.timeout = 100;	/* wait 100 usecs for DMA to finish */
 		dma_set_config(dma, chan, &config);
 		dma_start(dma, chan);
 	
@@ -121,14 +135,20 @@ int dma_copy_to_host(struct dma_sg_config *host_sg, int32_t host_offset,
 		/* update offset and bytes remaining */
 		size -= local_sg_elem.size;
 		host_offset += local_sg_elem.size;
+		if (size <= 0)
+			break;
+
+		/* local address is continuous */
+		local_sg_elem.src += local_sg_elem.size;
 
 		/* next dest host address is in next host elem */
+		if (list_item_is_last(&host_sg_elem->list, &host_sg->elem_list)) {
+			dma_channel_put(dma, chan);
+			return -EINVAL;
+		}
 		host_sg_elem = list_next_item(host_sg_elem, list);
 		local_sg_elem.dest = host_sg_elem->dest;
 
-		/* local address is continuous */
-		local_sg_elem.src = (uint32_t)local_ptr + local_sg_elem.size;
-
 		/* do we have less than 1 PAGE to copy ? */
 		if (size >= HOST_PAGE_SIZE)
 			local_sg_elem.size = HOST_PAGE_SIZE;
@@ -153,6 +173,11 @@ int dma_copy_from_host(struct dma_sg_config *host_sg, int32_t host_offset,
 	if (dma == NULL)
 		return -ENODEV;
 
+	/* find host element with host_offset */
+	host_sg_elem = sg_get_elem_at(host_sg, &offset);
+	if (host_sg_elem == NULL)
+		return -EINVAL;
+
 	/* get DMA channel from DMAC0 */
 	chan = dma_channel_get(dma);
 	if (chan < 0) {
@@ -160,23 +185,20 @@ int dma_copy_from_host(struct dma_sg_config *host_sg, int32_t host_offset,
 		return chan;
 	}
 
-	/* find host element with host_offset */
-	host_sg_elem = sg_get_elem_at(host_sg, &offset);
-	if (host_sg_elem == NULL)
-		return -EINVAL;
-
 	/* set up DMA configuration */
-	complete.timeout = 100;	/* wait 100 usecs for DMA to finish */
 	config.direction = DMA_DIR_HMEM_TO_LMEM;
 	config.src_width = sizeof(uint32_t);
 	config.dest_width = sizeof(uint32_t);
 	config.cyclic = 0;
 	list_init(&config.elem_list);
+	dma_set_cb(dma, chan, DMA_IRQ_TYPE_LLIST, dma_complete, &complete);
 
-	/* configure local DMA elem */
+	/* configure local DMA elem, first copy is to end of host elem */
 	local_sg_elem.dest = (uint32_t)local_ptr;
 	local_sg_elem.src = host_sg_elem->src + offset;
-	local_sg_elem.size = HOST_PAGE_SIZE - offset;
+	local_sg_elem.size = host_sg_elem->size - offset;
+	if (local_sg_elem.size > size)
+		local_sg_elem.size = size;
 	list_item_prepend(&local_sg_elem.list, &config.elem_list);
 
 	/* transfer max PAGE size at a time to SG buffer */
@@ -184,6 +206,7 @@ int dma_copy_from_host(struct dma_sg_config *host_sg, int32_t host_offset,
 
 		/* start the DMA */
 		wait_init(&complete);
+		complete.timeout = 100;	/* wait 100 usecs for DMA to finish */
 		dma_set_config(dma, chan, &config);
 		dma_start(dma, chan);
 	
@@ -198,14 +221,20 @@ int dma_copy_from_host(struct dma_sg_config *host_sg, int32_t host_offset,
 		/* update offset and bytes remaining */
 		size -= local_sg_elem.size;
 		host_offset += local_sg_elem.size;
+		if (size <= 0)
+			break;
 
-		/* next dest host address is in next host elem */
+		/* local address is continuous */
+		local_sg_elem.dest += local_sg_elem.size;
+
+		/* next source host address is in next host elem */
+		if (list_item_is_last(&host_sg_elem->list, &host_sg->elem_list)) {
+			dma_channel_put(dma, chan);
+			return -EINVAL;
+		}
 		host_sg_elem = list_next_item(host_sg_elem, list);
 		local_sg_elem.src = host_sg_elem->src;
 
-		/* local address is continuous */
-		local_sg_elem.dest = (uint32_t)local_ptr + local_sg_elem.size;
-
 		/* do we have less than 1 PAGE to copy ? */
 		if (size >= HOST_PAGE_SIZE)
 			local_sg_elem.size = HOST_PAGE_SIZE;
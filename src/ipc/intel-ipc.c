@@ -36,6 +36,7 @@
 
 #include <reef/debug.h>
 #include <reef/timer.h>
+#include <reef/clock.h>
 #include <reef/interrupt.h>
 #include <reef/ipc.h>
 #include <reef/mailbox.h>
@@ -46,13 +47,18 @@
 #include <reef/alloc.h>
 #include <reef/wait.h>
 #include <reef/trace.h>
+#include <reef/dma-trace.h>
 #include <reef/ssp.h>
 #include <platform/interrupt.h>
 #include <platform/mailbox.h>
 #include <platform/shim.h>
 #include <platform/dma.h>
+#include <platform/timer.h>
+#include <platform/clk.h>
+#include <platform/memory.h>
 #include <reef/audio/component.h>
 #include <reef/audio/pipeline.h>
+#include <reef/audio/buffer.h>
 #include <uapi/ipc.h>
 #include <reef/intel-ipc.h>
 #include <config.h>
@@ -60,6 +66,11 @@
 #define iGS(x) (x >> SOF_GLB_TYPE_SHIFT)
 #define iCS(x) (x >> SOF_CMD_TYPE_SHIFT)
 
+/* max host pages for PM context - heaps plus allocator and IPC state */
+#define IPC_PM_MAX_PAGES \
+	((HEAP_SYSTEM_SIZE + HEAP_RUNTIME_SIZE + HEAP_BUFFER_SIZE) / \
+	HOST_PAGE_SIZE + 4)
+
 /* IPC context - shared with platform IPC driver */
 struct ipc *_ipc;
 
@@ -67,8 +78,7 @@ static inline struct sof_ipc_hdr *mailbox_validate(void)
 {
 	struct sof_ipc_hdr *hdr = _ipc->comp_data;
 
-	/* read component values from the inbox */
-	mailbox_inbox_read(hdr, 0, sizeof(*hdr));
+	/* inbox data has already been copied by the platform IPC driver */
 
 	/* validate component header */
 	if (hdr->size > SOF_IPC_MSG_MAX_SIZE) {
@@ -76,8 +86,6 @@ static inline struct sof_ipc_hdr *mailbox_validate(void)
 		return NULL;
 	}
 
-	/* read rest of component data */
-	mailbox_inbox_read(hdr + 1, sizeof(*hdr), hdr->size - sizeof(*hdr));
 	return hdr;
 }
 
@@ -148,6 +156,40 @@ out:
 	return ret;
 }
 
+/* get page physical address from compressed page table - 20 bits per page */
+static inline uint32_t page_table_get_addr(struct intel_ipc_data *iipc,
+	int i)
+{
+	uint32_t idx, phy_addr;
+
+	idx = (((i << 2) + i)) >> 1;
+	phy_addr = iipc->page_table[idx] | (iipc->page_table[idx + 1] << 8)
+			| (iipc->page_table[idx + 2] << 16);
+
+	if (i & 0x1)
+		phy_addr <<= 8;
+	else
+		phy_addr <<= 12;
+
+	return phy_addr & 0xfffff000;
+}
+
+/* create host SG list from page table - elem must hold pages entries */
+static void page_table_sg_init(struct intel_ipc_data *iipc,
+	struct sof_ipc_host_buffer *buffer, struct dma_sg_config *host_sg,
+	struct dma_sg_elem *elem)
+{
+	int i;
+
+	list_init(&host_sg->elem_list);
+	for (i = 0; i < buffer->pages; i++) {
+		elem[i].src = page_table_get_addr(iipc, i);
+		elem[i].dest = elem[i].src;
+		elem[i].size = HOST_PAGE_SIZE;
+		list_item_append(&elem[i].list, &host_sg->elem_list);
+	}
+}
+
 /*
  * Parse the host page tables and create the audio DMA SG configuration
  * for host audio DMA buffer. This involves creating a dma_sg_elem for each
@@ -159,21 +201,13 @@ static int parse_page_descriptors(struct intel_ipc_data *iipc,
 	struct sof_ipc_comp_host *host = (struct sof_ipc_comp_host *)&cd->comp;
 	struct dma_sg_elem elem;
 	int i, err;
-	uint32_t idx, phy_addr;
+	uint32_t phy_addr;
 
 	elem.size = HOST_PAGE_SIZE;
 
 	for (i = 0; i < ring->pages; i++) {
 
-		idx = (((i << 2) + i)) >> 1;
-		phy_addr = iipc->page_table[idx] | (iipc->page_table[idx + 1] << 8)
-				| (iipc->page_table[idx + 2] << 16);
-
-		if (i & 0x1)
-			phy_addr <<= 8;
-		else
-			phy_addr <<= 12;
-		phy_addr &= 0xfffff000;
+		phy_addr = page_table_get_addr(iipc, i);
 
 		if (host->direction == SOF_IPC_STREAM_PLAYBACK)
 			elem.src = phy_addr;
@@ -190,6 +224,20 @@ static int parse_page_descriptors(struct intel_ipc_data *iipc,
 	return 0;
 }
 
+/* tell host DSP has no time for pipeline */
+static void ipc_sched_reply(int error)
+{
+	struct sof_ipc_sched_reply reply;
+
+	reply.hdr.cmd = SOF_IPC_GLB_REPLY | SOF_IPC_REPLY_ERROR;
+	reply.hdr.size = sizeof(reply);
+	reply.error = error;
+	reply.utilisation = schedule_utilisation();
+	reply.utilisation_max = schedule_utilisation_max();
+
+	mailbox_outbox_write(0, &reply, sizeof(reply));
+}
+
 /*
  * Stream IPC Operations.
  */
@@ -277,8 +325,15 @@ static int ipc_stream_trigger(uint32_t header)
 		goto error;
 	}
 
-	switch (header) {
+	switch (header & SOF_CMD_TYPE_MASK) {
 	case SOF_IPC_STREAM_TRIG_START:
+		/* only started pipelines use DSP time */
+		err = schedule_task_admit(&pcm_dev->cd->pipeline->pipe_task);
+		if (err < 0) {
+			trace_ipc_error("eRa");
+			ipc_sched_reply(err);
+			return err;
+		}
 		cmd = COMP_CMD_START;
 		break;
 	case SOF_IPC_STREAM_TRIG_STOP:
@@ -303,13 +358,73 @@ static int ipc_stream_trigger(uint32_t header)
 			cmd, NULL);
 	if (err < 0) {
 		trace_ipc_error("eRc");
+		if (cmd == COMP_CMD_START)
+			schedule_task_release(
+				&pcm_dev->cd->pipeline->pipe_task);
 		goto error;
 	}
 
+	/* stopped pipelines give their time back */
+	if (cmd == COMP_CMD_STOP)
+		schedule_task_release(&pcm_dev->cd->pipeline->pipe_task);
+
 error:
 	return 0;
 }
 
+static void ipc_buffer_status_fill(struct comp_buffer *buffer,
+	struct sof_ipc_buffer_status *status)
+{
+	status->hdr.cmd = SOF_IPC_GLB_STREAM_MSG | SOF_IPC_STREAM_BUFFER_STATUS;
+	status->hdr.size = sizeof(*status);
+	status->buffer_id = buffer->ipc_buffer.comp.id;
+	status->size = buffer->ipc_buffer.size;
+	status->underruns = buffer->stats.underruns;
+	status->overruns = buffer->stats.overruns;
+	status->high_water = buffer->stats.high_water;
+	status->low_water = buffer->stats.low_water;
+	status->last_xrun = buffer->stats.last_xrun;
+}
+
+/* get buffer health statistics */
+static int ipc_stream_buffer_status(uint32_t header)
+{
+	struct sof_ipc_buffer_status *query = _ipc->comp_data;
+	struct sof_ipc_buffer_status status;
+	struct ipc_buffer_dev *icb;
+
+	trace_ipc("SBs");
+
+	icb = ipc_get_buffer(_ipc, query->buffer_id);
+	if (icb == NULL) {
+		trace_ipc_error("eBg");
+		return -ENODEV;
+	}
+
+	ipc_buffer_status_fill(icb->cb, &status);
+	mailbox_outbox_write(0, &status, sizeof(status));
+
+	return 0;
+}
+
+static int ipc_stream_posn_params(uint32_t header)
+{
+	struct sof_ipc_stream_posn_params *posn = _ipc->comp_data;
+	struct ipc_comp_dev *pcm_dev;
+
+	trace_ipc("SPp");
+
+	/* only host components send position notifications */
+	pcm_dev = ipc_get_comp(_ipc, posn->comp_id);
+	if (pcm_dev == NULL || pcm_dev->cd->comp.type != SOF_COMP_HOST) {
+		trace_ipc_error("ePn");
+		return -ENODEV;
+	}
+
+	return comp_cmd(pcm_dev->cd, COMP_CMD_POSN_NOTIFY,
+		&posn->notify_bytes);
+}
+
 static int ipc_glb_stream_message(uint32_t header)
 {
 	uint32_t cmd = (header & SOF_CMD_TYPE_MASK) >> SOF_CMD_TYPE_SHIFT;
@@ -326,6 +441,10 @@ static int ipc_glb_stream_message(uint32_t header)
 	case iCS(SOF_IPC_STREAM_TRIG_DRAIN):
 	case iCS(SOF_IPC_STREAM_TRIG_XRUN):
 		return ipc_stream_trigger(header);
+	case iCS(SOF_IPC_STREAM_BUFFER_STATUS):
+		return ipc_stream_buffer_status(header);
+	case iCS(SOF_IPC_STREAM_POSN_PARAMS):
+		return ipc_stream_posn_params(header);
 	default:
 		return -EINVAL;
 	}
@@ -363,6 +482,95 @@ error:
  * PM IPC Operations.
  */
 
+/* PM context host SG list - must not be on the heaps being saved */
+static struct dma_sg_elem pm_elem[IPC_PM_MAX_PAGES];
+
+#define IPC_PM_FIELD(f) \
+	{offsetof(struct ipc, f), sizeof(((struct ipc *)0)->f)}
+
+/* IPC topology state is allocated at boot so save it with the context */
+static const struct {
+	uint32_t offset;
+	uint32_t size;
+} ipc_pm_state[] = {
+	IPC_PM_FIELD(posn_used),
+	IPC_PM_FIELD(posn_notify),
+	IPC_PM_FIELD(posn_xrun),
+	IPC_PM_FIELD(buffer_xrun),
+	IPC_PM_FIELD(pipeline_list),
+	IPC_PM_FIELD(comp_list),
+	IPC_PM_FIELD(buffer_list),
+	IPC_PM_FIELD(pipeline_hash),
+	IPC_PM_FIELD(comp_hash),
+	IPC_PM_FIELD(buffer_hash),
+};
+
+static uint32_t ipc_pm_state_size(void)
+{
+	uint32_t size = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ipc_pm_state); i++)
+		size += ipc_pm_state[i].size;
+
+	return size;
+}
+
+/* create host SG list for PM context buffer */
+static int ipc_pm_context_sg(struct sof_ipc_pm_ctx *pm_ctx,
+	struct dma_sg_config *host_sg)
+{
+	struct intel_ipc_data *iipc = ipc_get_drvdata(_ipc);
+	struct sof_ipc_host_buffer *buffer = &pm_ctx->buffer;
+	uint32_t size = mm_pm_context_size() + ipc_pm_state_size();
+	int ret;
+
+	if (buffer->pages == 0 || buffer->pages > IPC_PM_MAX_PAGES ||
+		buffer->size < size ||
+		buffer->size > buffer->pages * HOST_PAGE_SIZE) {
+		trace_ipc_error("ePz");
+		return -EINVAL;
+	}
+
+	/* use DMA to read in compressed page table from host */
+	ret = get_page_descriptors(iipc, buffer);
+	if (ret < 0) {
+		trace_ipc_error("ePp");
+		return ret;
+	}
+
+	page_table_sg_init(iipc, buffer, host_sg, pm_elem);
+	return 0;
+}
+
+/* copy IPC state to or from host after the heap context */
+static int ipc_pm_state_copy(struct dma_sg_config *host_sg, int save)
+{
+	uint32_t offset = mm_pm_context_size();
+	uint32_t size;
+	void *ptr;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(ipc_pm_state); i++) {
+		ptr = (void *)_ipc + ipc_pm_state[i].offset;
+		size = ipc_pm_state[i].size;
+
+		if (save) {
+			dcache_writeback_region(ptr, size);
+			ret = dma_copy_to_host(host_sg, offset, ptr, size);
+		} else {
+			ret = dma_copy_from_host(host_sg, offset, ptr, size);
+			dcache_invalidate_region(ptr, size);
+		}
+		if (ret < 0)
+			return ret;
+
+		offset += size;
+	}
+
+	return 0;
+}
+
 static int ipc_pm_context_size(uint32_t header)
 {
 	struct sof_ipc_pm_ctx pm_ctx;
@@ -371,7 +579,10 @@ static int ipc_pm_context_size(uint32_t header)
 
 	bzero(&pm_ctx, sizeof(pm_ctx));
 
-	/* TODO: calculate the context and size of host buffers required */
+	/* host buffer must hold the heap and IPC context */
+	pm_ctx.hdr.cmd = SOF_IPC_GLB_REPLY;
+	pm_ctx.hdr.size = sizeof(pm_ctx);
+	pm_ctx.size = mm_pm_context_size() + ipc_pm_state_size();
 
 	/* write the context to the host driver */
 	mailbox_outbox_write(0, &pm_ctx, sizeof(pm_ctx));
@@ -379,18 +590,75 @@ static int ipc_pm_context_size(uint32_t header)
 	return 0;
 }
 
+/* send cmd to every component, continuing past any that fail */
+static int ipc_pm_comp_cmd(int cmd)
+{
+	struct ipc_comp_dev *icd;
+	struct list_item *clist;
+	int ret = 0, err;
+
+	list_for_item(clist, &_ipc->comp_list) {
+		icd = container_of(clist, struct ipc_comp_dev, list);
+		err = comp_cmd(icd->cd, cmd, NULL);
+		if (err < 0) {
+			trace_ipc_error("ePd");
+			ret = err;
+		}
+	}
+
+	return ret;
+}
+
 static int ipc_pm_context_save(uint32_t header)
 {
 	struct sof_ipc_pm_ctx *pm_ctx = _ipc->comp_data;
+	struct dma_sg_config host_sg;
+	struct ipc_comp_dev *icd;
+	struct list_item *clist;
+	int ret;
 
-	trace_ipc("PMs");
+	trace_ipc("PMS");
 
-	/* TODO: check we are inactive - all streams are suspended */
+	/* check we are inactive - all streams are suspended */
+	list_for_item(clist, &_ipc->comp_list) {
+		icd = container_of(clist, struct ipc_comp_dev, list);
+		if (icd->cd->state == COMP_STATE_RUNNING ||
+			icd->cd->state == COMP_STATE_PAUSED) {
+			trace_ipc_error("ePa");
+			return -EBUSY;
+		}
+	}
+
+	ret = ipc_pm_context_sg(pm_ctx, &host_sg);
+	if (ret < 0)
+		return ret;
 
 	/* TODO: mask ALL platform interrupts except DMA */
 
-	/* TODO now save the context - create SG buffer config using */
-	//mm_pm_context_save(struct dma_sg_config *sg);
+	/* release component DMA so no channel state is left in the heaps */
+	ret = ipc_pm_comp_cmd(COMP_CMD_SUSPEND);
+	if (ret < 0)
+		goto err;
+
+	/* now save the context, heaps first as IPC state follows them */
+	ret = mm_pm_context_save(&host_sg);
+	if (ret < 0) {
+		trace_ipc_error("ePm");
+		goto err;
+	}
+
+	ret = ipc_pm_state_copy(&host_sg, 1);
+	if (ret < 0) {
+		trace_ipc_error("ePi");
+		goto err;
+	}
+
+	/* context is only valid for restore once all of it is saved */
+	ret = mm_pm_context_commit(&host_sg);
+	if (ret < 0) {
+		trace_ipc_error("ePh");
+		goto err;
+	}
 
 	/* mask all DSP interrupts */
 	arch_interrupt_disable_mask(0xffff);
@@ -404,25 +672,82 @@ static int ipc_pm_context_save(uint32_t header)
 
 	/* TODO: disable SSP and DMA HW */
 
-	/* TODO: save the context */
-	//reply.entries_no = 0;
-
 	/* write the context to the host driver */
+	pm_ctx->hdr.cmd = SOF_IPC_GLB_REPLY;
+	pm_ctx->hdr.size = sizeof(*pm_ctx);
+	pm_ctx->num_elems = 0;
+	pm_ctx->size = mm_pm_context_size() + ipc_pm_state_size();
 	mailbox_outbox_write(0, pm_ctx, sizeof(*pm_ctx));
 
 	//iipc->pm_prepare_D3 = 1;
 
 	return 0;
+
+err:
+	/* we stay up so components need their DMA back */
+	ipc_pm_comp_cmd(COMP_CMD_RESUME);
+	return ret;
 }
 
 static int ipc_pm_context_restore(uint32_t header)
 {
-//	struct sof_ipc_pm_ctx pm_ctx = _ipc->comp_data;
+	struct sof_ipc_pm_ctx *pm_ctx = _ipc->comp_data;
+	struct dma_sg_config host_sg;
+	int ret;
 
 	trace_ipc("PMr");
 
+	ret = ipc_pm_context_sg(pm_ctx, &host_sg);
+	if (ret < 0)
+		return ret;
+
 	/* now restore the context */
+	ret = mm_pm_context_restore(&host_sg);
+	if (ret < 0) {
+		trace_ipc_error("ePR");
+		return ret;
+	}
+
+	/* heaps are restored so topology must be too or we cannot continue */
+	ret = ipc_pm_state_copy(&host_sg, 0);
+	if (ret < 0) {
+		trace_ipc_error("ePI");
+		panic(PANIC_MEM);
+		return ret;
+	}
 
+	/* DMA channels and callbacks are boot state so get them again */
+	return ipc_pm_comp_cmd(COMP_CMD_RESUME);
+}
+
+/* count wakeups from idle and latch the rate once per second */
+void ipc_pm_wakeup(void)
+{
+	uint32_t current = platform_timer_get(NULL);
+
+	_ipc->wake_count++;
+	_ipc->wake_window++;
+
+	if (current - _ipc->wake_start >=
+		clock_us_to_ticks(PLATFORM_SCHED_CLOCK, 1000000)) {
+		_ipc->wake_rate = _ipc->wake_window;
+		_ipc->wake_window = 0;
+		_ipc->wake_start = current;
+	}
+}
+
+static int ipc_pm_wake_stats(uint32_t header)
+{
+	struct sof_ipc_pm_wake_stats stats;
+
+	trace_ipc("PMw");
+
+	stats.hdr.cmd = SOF_IPC_GLB_REPLY;
+	stats.hdr.size = sizeof(stats);
+	stats.wakeups = _ipc->wake_count;
+	stats.wakeups_per_sec = _ipc->wake_rate;
+
+	mailbox_outbox_write(0, &stats, sizeof(stats));
 	return 0;
 }
 
@@ -437,6 +762,8 @@ static int ipc_glb_pm_message(uint32_t header)
 		return ipc_pm_context_restore(header);
 	case iCS(SOF_IPC_PM_CTX_SIZE):
 		return ipc_pm_context_size(header);
+	case iCS(SOF_IPC_PM_WAKE_STATS):
+		return ipc_pm_wake_stats(header);
 	case iCS(SOF_IPC_PM_CLK_SET):
 	case iCS(SOF_IPC_PM_CLK_GET):
 	case iCS(SOF_IPC_PM_CLK_REQ):
@@ -551,10 +878,73 @@ static int ipc_glb_tplg_buffer_new(uint32_t header)
 static int ipc_glb_tplg_pipe_new(uint32_t header)
 {
 	struct sof_ipc_pipe_new *ipc_pipeline = _ipc->comp_data;
+	struct sof_ipc_pipe_new pipe_desc;
+	uint32_t size = ipc_pipeline->hdr.size;
+	int ret;
 
 	trace_ipc("Tpn");
 
-	return ipc_pipeline_new(_ipc, ipc_pipeline);
+	/* older hosts don't send period, flags or DMA periods */
+	if (size < offsetof(struct sof_ipc_pipe_new, period_frames)) {
+		trace_ipc_error("eTn");
+		return -EINVAL;
+	}
+
+	/* fields the host didn't send default to 0 */
+	if (size > sizeof(pipe_desc))
+		size = sizeof(pipe_desc);
+	bzero(&pipe_desc, sizeof(pipe_desc));
+	rmemcpy(&pipe_desc, ipc_pipeline, size);
+
+	ret = ipc_pipeline_new(_ipc, &pipe_desc);
+	if (ret == -EBUSY)
+		ipc_sched_reply(ret);
+
+	return ret;
+}
+
+static int ipc_glb_tplg_pipe_complete(uint32_t header)
+{
+	struct sof_ipc_pipe_ready *ipc_pipeline = _ipc->comp_data;
+
+	trace_ipc("Tpc");
+
+	return ipc_pipeline_complete(_ipc, ipc_pipeline->pipeline_id);
+}
+
+/* get pipeline scheduling statistics */
+static int ipc_glb_tplg_pipe_status(uint32_t header)
+{
+	struct sof_ipc_pipe_status *query = _ipc->comp_data;
+	struct sof_ipc_pipe_status status;
+	struct ipc_pipeline_dev *ipc_pipe;
+	struct task *task;
+
+	trace_ipc("Tps");
+
+	ipc_pipe = ipc_get_pipeline(_ipc, query->pipeline_id);
+	if (ipc_pipe == NULL) {
+		trace_ipc_error("ePs");
+		return -ENODEV;
+	}
+
+	task = &ipc_pipe->pipeline->pipe_task;
+
+	status.hdr.cmd = SOF_IPC_GLB_TPLG_MSG | SOF_IPC_TPLG_PIPE_STATUS;
+	status.hdr.size = sizeof(status);
+	status.pipeline_id = query->pipeline_id;
+	status.max_rtime = task->max_rtime;
+	status.max_response = task->max_response;
+	status.preemptions = task->preemptions;
+	status.deadline_misses = task->deadline_misses;
+	status.inplace_bytes = ipc_pipe->pipeline->inplace_bytes;
+	status.inplace_period_bytes = ipc_pipe->pipeline->inplace_period_bytes;
+	status.scratch_bytes = ipc_pipe->pipeline->scratch_bytes;
+	status.scratch_size = ipc_pipe->pipeline->scratch_size;
+	status.start_latency = ipc_pipe->pipeline->start_latency;
+	mailbox_outbox_write(0, &status, sizeof(status));
+
+	return 0;
 }
 
 static int ipc_glb_tplg_comp_connect(uint32_t header)
@@ -605,8 +995,10 @@ static int ipc_glb_tplg_message(uint32_t header)
 		return ipc_glb_tplg_free(header, ipc_pipeline_free);
 	case iCS(SOF_IPC_TPLG_PIPE_CONNECT):
 		return ipc_glb_tplg_pipe_connect(header);
-	//case SOF_IPC_TPLG_PIPE_COMPLETE:
-	//	return ipc_glb_tplg_pipe_complete(header);
+	case iCS(SOF_IPC_TPLG_PIPE_COMPLETE):
+		return ipc_glb_tplg_pipe_complete(header);
+	case iCS(SOF_IPC_TPLG_PIPE_STATUS):
+		return ipc_glb_tplg_pipe_status(header);
 	case iCS(SOF_IPC_TPLG_BUFFER_NEW):
 		return ipc_glb_tplg_buffer_new(header);
 	case iCS(SOF_IPC_TPLG_BUFFER_FREE):
@@ -619,35 +1011,126 @@ static int ipc_glb_tplg_message(uint32_t header)
 }
 
 /*
- * Global IPC Operations.
+ * Debug IPC Operations.
  */
 
-int ipc_cmd(void)
+/* host has allocated a buffer for DMA trace */
+static int ipc_dma_trace_config(uint32_t header)
 {
-	struct sof_ipc_hdr *hdr;
-	uint32_t type;
+	struct intel_ipc_data *iipc = ipc_get_drvdata(_ipc);
+	struct sof_ipc_dma_trace_params *params = _ipc->comp_data;
+	struct sof_ipc_host_buffer *buffer = &params->buffer;
+	struct dma_sg_config host_sg;
+	struct dma_sg_elem *elem;
+	int ret;
 
-	hdr = mailbox_validate();
-	if (hdr == NULL) {
-		trace_ipc_error("hdr");
+	trace_ipc("DAl");
+
+	if (buffer->pages == 0 || buffer->pages > DMA_TRACE_HOST_PAGES ||
+		buffer->size > buffer->pages * HOST_PAGE_SIZE) {
+		trace_ipc_error("eDs");
 		return -EINVAL;
 	}
 
-	type = (hdr->cmd & SOF_GLB_TYPE_MASK) >> SOF_GLB_TYPE_SHIFT;
+	/* use DMA to read in compressed page table from host */
+	ret = get_page_descriptors(iipc, buffer);
+	if (ret < 0) {
+		trace_ipc_error("eDp");
+		return ret;
+	}
+
+	/* SG list is used for the life of the trace */
+	elem = rzalloc(RZONE_SYS, RFLAGS_NONE, sizeof(*elem) * buffer->pages);
+	if (elem == NULL) {
+		trace_ipc_error("eDm");
+		return -ENOMEM;
+	}
+
+	page_table_sg_init(iipc, buffer, &host_sg, elem);
+
+	ret = dma_trace_enable(&host_sg, buffer->size);
+	if (ret < 0) {
+		trace_ipc_error("eDe");
+		rfree(elem);
+		return ret;
+	}
+
+	return 0;
+}
+
+/* set runtime trace class filter */
+static int ipc_trace_filter(uint32_t header)
+{
+	struct sof_ipc_trace_filter *filter = _ipc->comp_data;
+
+	trace_ipc("DFl");
+
+	trace_set_filter(TRACE_LEVEL_ERROR, filter->error);
+	trace_set_filter(TRACE_LEVEL_INFO, filter->info);
+	trace_set_filter(TRACE_LEVEL_VERBOSE, filter->verbose);
+
+	return 0;
+}
+
+/* get errors from posted commands that host was not told about */
+static int ipc_posted_status(uint32_t header)
+{
+	struct sof_ipc_posted_status status;
+
+	trace_ipc("DPs");
+
+	status.hdr.cmd = SOF_IPC_GLB_REPLY;
+	status.hdr.size = sizeof(status);
+	status.errors = _ipc->posted_errors;
+	status.last_cmd = _ipc->posted_last_cmd;
+	status.last_error = _ipc->posted_last_error;
+
+	mailbox_outbox_write(0, &status, sizeof(status));
+	return 0;
+}
+
+static int ipc_glb_trace_message(uint32_t header)
+{
+	uint32_t cmd = (header & SOF_CMD_TYPE_MASK) >> SOF_CMD_TYPE_SHIFT;
+
+	switch (cmd) {
+	case iCS(SOF_IPC_TRACE_DMA_PARAMS):
+		return ipc_dma_trace_config(header);
+	case iCS(SOF_IPC_TRACE_FILTER):
+		return ipc_trace_filter(header);
+	case iCS(SOF_IPC_TRACE_POSTED_STATUS):
+		return ipc_posted_status(header);
+	default:
+		trace_ipc_error("eDc");
+		trace_value(header);
+		return -EINVAL;
+	}
+}
+
+/*
+ * Global IPC Operations.
+ */
+
+/* process command in comp_data */
+static int ipc_cmd_process(uint32_t cmd)
+{
+	uint32_t type;
+
+	type = (cmd & SOF_GLB_TYPE_MASK) >> SOF_GLB_TYPE_SHIFT;
 
 	switch (type) {
 	case iGS(SOF_IPC_GLB_REPLY):
 		return 0;
-	case iGS(SOF_IPC_GLB_COMPOUND):
-		return -EINVAL;	/* TODO */
 	case iGS(SOF_IPC_GLB_TPLG_MSG):
-		return ipc_glb_tplg_message(hdr->cmd);
+		return ipc_glb_tplg_message(cmd);
 	case iGS(SOF_IPC_GLB_PM_MSG):
-		return ipc_glb_pm_message(hdr->cmd);
+		return ipc_glb_pm_message(cmd);
 	case iGS(SOF_IPC_GLB_COMP_MSG):
-		return ipc_glb_comp_message(hdr->cmd);
+		return ipc_glb_comp_message(cmd);
 	case iGS(SOF_IPC_GLB_STREAM_MSG):
-		return ipc_glb_stream_message(hdr->cmd);
+		return ipc_glb_stream_message(cmd);
+	case iGS(SOF_IPC_GLB_TRACE_MSG):
+		return ipc_glb_trace_message(cmd);
 	default:
 		trace_ipc_error("eGc");
 		trace_value(type);
@@ -655,6 +1138,219 @@ int ipc_cmd(void)
 	}
 }
 
+/*
+ * Compound commands contain blocks of commands, each block starts with a
+ * compound header giving the command type and number of commands in the
+ * block. Each command is processed in order as if it had been sent on its
+ * own and a single reply is sent for the whole sequence.
+ */
+static int ipc_glb_compound_message(struct sof_ipc_hdr *hdr)
+{
+	struct sof_ipc_compound_reply reply;
+	struct sof_ipc_compound_hdr *block;
+	struct sof_ipc_hdr *sub;
+	uint8_t *data = (uint8_t *)hdr;
+	uint32_t offset = sizeof(*hdr);
+	uint32_t i;
+	int ret = 0;
+
+	trace_ipc("Cmp");
+
+	reply.count = 0;
+
+	while (offset + sizeof(*block) <= hdr->size) {
+
+		block = (struct sof_ipc_compound_hdr *)(data + offset);
+		offset += sizeof(*block);
+
+		/* end of compound sequence ? */
+		if (block->count == 0)
+			break;
+
+		for (i = 0; i < block->count; i++) {
+
+			/* command must be word aligned and within message */
+			sub = (struct sof_ipc_hdr *)(data + offset);
+			if (offset + sizeof(*sub) > hdr->size ||
+				sub->size < sizeof(*sub) ||
+				sub->size % sizeof(uint32_t) ||
+				offset + sub->size > hdr->size) {
+				trace_ipc_error("eCs");
+				ret = -EINVAL;
+				goto out;
+			}
+
+			/* commands use comp_data so point it at this command */
+			_ipc->comp_data = sub;
+			ret = ipc_cmd_process(block->hdr.cmd);
+			_ipc->comp_data = hdr;
+			if (ret < 0) {
+				trace_ipc_error("eCc");
+				trace_value(reply.count);
+				goto out;
+			}
+
+			offset += sub->size;
+			reply.count++;
+		}
+	}
+
+out:
+	/* write aggregated reply to the outbox */
+	reply.hdr.cmd = SOF_IPC_GLB_REPLY;
+	reply.hdr.cmd |= ret < 0 ? SOF_IPC_REPLY_ERROR : SOF_IPC_REPLY_SUCCESS;
+	reply.hdr.size = sizeof(reply);
+	reply.error = ret;
+	mailbox_outbox_write(0, &reply, sizeof(reply));
+
+	return ret;
+}
+
+/*
+ * Bulk commands are too large for the mailbox so they are copied from host
+ * pages by DMA and then processed in the same way as mailbox commands.
+ */
+static int ipc_glb_bulk_message(struct sof_ipc_hdr *hdr)
+{
+	struct intel_ipc_data *iipc = ipc_get_drvdata(_ipc);
+	struct sof_ipc_bulk *bulk = (struct sof_ipc_bulk *)hdr;
+	struct sof_ipc_host_buffer *buffer = &bulk->buffer;
+	struct dma_sg_config host_sg;
+	struct dma_sg_elem *elem = NULL;
+	struct sof_ipc_hdr *cmd = NULL;
+	uint32_t type;
+	int ret;
+
+	trace_ipc("Blk");
+
+	/* validate bulk command size and host pages */
+	if (buffer->size < sizeof(*cmd) || buffer->size > IPC_BULK_MAX_SIZE ||
+		buffer->pages > IPC_BULK_MAX_SIZE / HOST_PAGE_SIZE + 1 ||
+		buffer->offset + buffer->size > buffer->pages * HOST_PAGE_SIZE) {
+		trace_ipc_error("eBs");
+		return -EINVAL;
+	}
+
+	/* use DMA to read in compressed page table from host */
+	ret = get_page_descriptors(iipc, buffer);
+	if (ret < 0) {
+		trace_ipc_error("eBp");
+		return ret;
+	}
+
+	elem = rzalloc(RZONE_RUNTIME, RFLAGS_NONE,
+		sizeof(*elem) * buffer->pages);
+	cmd = rballoc(RZONE_RUNTIME, RFLAGS_NONE, buffer->size);
+	if (elem == NULL || cmd == NULL) {
+		trace_ipc_error("eBm");
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* create host SG list from page table */
+	page_table_sg_init(iipc, buffer, &host_sg, elem);
+
+	/* copy command from host */
+	ret = dma_copy_from_host(&host_sg, buffer->offset, cmd, buffer->size);
+	if (ret < 0) {
+		trace_ipc_error("eBc");
+		goto out;
+	}
+
+	/* command was written by DMA so don't read stale cache lines */
+	dcache_invalidate_region(cmd, buffer->size);
+
+	/* command must fit in bulk buffer and bulk commands can't be nested */
+	type = cmd->cmd & SOF_GLB_TYPE_MASK;
+	if (cmd->size > buffer->size || type == SOF_IPC_GLB_BULK) {
+		trace_ipc_error("eBh");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* commands use comp_data so point it at the bulk command */
+	_ipc->comp_data = cmd;
+	if (type == SOF_IPC_GLB_COMPOUND)
+		ret = ipc_glb_compound_message(cmd);
+	else
+		ret = ipc_cmd_process(cmd->cmd);
+	_ipc->comp_data = hdr;
+
+out:
+	if (cmd != NULL)
+		rbfree(cmd);
+	if (elem != NULL)
+		rfree(elem);
+	return ret;
+}
+
+int ipc_cmd(void)
+{
+	struct sof_ipc_hdr *hdr;
+	uint32_t type;
+
+	hdr = mailbox_validate();
+	if (hdr == NULL) {
+		trace_ipc_error("hdr");
+		return -EINVAL;
+	}
+
+	type = (hdr->cmd & SOF_GLB_TYPE_MASK) >> SOF_GLB_TYPE_SHIFT;
+
+	switch (type) {
+	case iGS(SOF_IPC_GLB_COMPOUND):
+		return ipc_glb_compound_message(hdr);
+	case iGS(SOF_IPC_GLB_BULK):
+		return ipc_glb_bulk_message(hdr);
+	default:
+		return ipc_cmd_process(hdr->cmd);
+	}
+}
+
+/*
+ * Posted commands don't return any data in the outbox so the host can be told
+ * they are complete as soon as they are queued. This lets the host send
+ * independent commands without waiting for each one to be processed. Errors
+ * from posted commands are counted for SOF_IPC_TRACE_POSTED_STATUS.
+ */
+int ipc_cmd_is_posted(struct sof_ipc_hdr *hdr)
+{
+	uint32_t type = hdr->cmd & SOF_GLB_TYPE_MASK;
+	uint32_t cmd = hdr->cmd & SOF_CMD_TYPE_MASK;
+
+	switch (type) {
+	case SOF_IPC_GLB_STREAM_MSG:
+		switch (cmd) {
+		case SOF_IPC_STREAM_PCM_FREE:
+		case SOF_IPC_STREAM_TRIG_STOP:
+		case SOF_IPC_STREAM_TRIG_PAUSE:
+		case SOF_IPC_STREAM_TRIG_RELEASE:
+		case SOF_IPC_STREAM_TRIG_DRAIN:
+		case SOF_IPC_STREAM_TRIG_XRUN:
+			return 1;
+		default:
+			return 0;
+		}
+	case SOF_IPC_GLB_COMP_MSG:
+		switch (cmd) {
+		case SOF_IPC_COMP_SET_VOLUME:
+		case SOF_IPC_COMP_SET_MIXER:
+		case SOF_IPC_COMP_SET_MUX:
+		case SOF_IPC_COMP_SET_SRC:
+		case SOF_IPC_COMP_SSP_CONFIG:
+		case SOF_IPC_COMP_LOOPBACK:
+			return 1;
+		default:
+			return 0;
+		}
+	case SOF_IPC_GLB_TRACE_MSG:
+		return cmd == SOF_IPC_TRACE_FILTER;
+	default:
+		/* topology, PM, compound and bulk commands are processed in order */
+		return 0;
+	}
+}
+
 /* locks held by caller */
 static inline struct ipc_msg *msg_get_empty(struct ipc *ipc)
 {
@@ -680,6 +1376,159 @@ int ipc_stream_send_notification(struct comp_dev *cdev,
 		NULL, 0, NULL, NULL);
 }
 
+/*
+ * Stream positions are written to a table in the mailbox stream region every
+ * period so the host can read them without IPC. Notifications are only sent
+ * when a stream reaches its notification interval or has an xrun, and are
+ * batched so one notification covers all streams updated since the last one.
+ */
+#define POSN_TABLE_ENTRIES \
+	(MAILBOX_STREAM_SIZE / sizeof(struct sof_ipc_stream_posn_entry))
+
+/* get a position table entry for stream - returns entry or negative error */
+int ipc_stream_posn_get(uint32_t comp_id)
+{
+	volatile struct sof_ipc_stream_posn_entry *table =
+		(struct sof_ipc_stream_posn_entry *)MAILBOX_STREAM_BASE;
+	uint32_t flags;
+	int i, ret = -ENOMEM;
+
+	spin_lock_irq(&_ipc->lock, flags);
+
+	for (i = 0; i < POSN_TABLE_ENTRIES; i++) {
+
+		if (_ipc->posn_used & (1 << i))
+			continue;
+
+		_ipc->posn_used |= 1 << i;
+		table[i].comp_id = comp_id;
+		table[i].host_posn = 0;
+		table[i].xrun_count = 0;
+		table[i].timestamp = 0;
+		table[i].seq = 2;
+		dcache_writeback_region((void *)&table[i], sizeof(table[i]));
+		ret = i;
+		break;
+	}
+
+	spin_unlock_irq(&_ipc->lock, flags);
+
+	if (ret < 0)
+		trace_ipc_error("ePt");
+	return ret;
+}
+
+void ipc_stream_posn_put(int entry)
+{
+	volatile struct sof_ipc_stream_posn_entry *table =
+		(struct sof_ipc_stream_posn_entry *)MAILBOX_STREAM_BASE;
+	uint32_t flags;
+
+	spin_lock_irq(&_ipc->lock, flags);
+
+	table[entry].seq = 0;
+	dcache_writeback_region((void *)&table[entry], sizeof(table[entry]));
+	_ipc->posn_used &= ~(1 << entry);
+	_ipc->posn_notify &= ~(1 << entry);
+	_ipc->posn_xrun &= ~(1 << entry);
+
+	spin_unlock_irq(&_ipc->lock, flags);
+}
+
+/* update stream position in table - can be called from IRQ context */
+void ipc_stream_posn_update(int entry, uint32_t host_posn, int notify,
+	int xrun)
+{
+	volatile struct sof_ipc_stream_posn_entry *table =
+		(struct sof_ipc_stream_posn_entry *)MAILBOX_STREAM_BASE;
+	volatile struct sof_ipc_stream_posn_entry *posn = &table[entry];
+	uint32_t flags;
+
+	spin_lock_irq(&_ipc->lock, flags);
+
+	/* seq is odd whilst we update */
+	posn->seq++;
+	posn->host_posn = host_posn;
+	posn->timestamp = platform_timer_get(NULL);
+	if (xrun)
+		posn->xrun_count++;
+	posn->seq++;
+	dcache_writeback_region((void *)posn, sizeof(*posn));
+
+	/* notification is sent later from IPC context */
+	if (notify || xrun) {
+		_ipc->posn_notify |= 1 << entry;
+		_ipc->dsp_pending = 1;
+	}
+	if (xrun)
+		_ipc->posn_xrun |= 1 << entry;
+
+	spin_unlock_irq(&_ipc->lock, flags);
+}
+
+/* send one notification for all pending stream positions */
+static void ipc_stream_posn_notify(void)
+{
+	struct sof_ipc_stream_posn_notify posn;
+	uint32_t flags;
+
+	spin_lock_irq(&_ipc->lock, flags);
+	posn.entries = _ipc->posn_notify;
+	posn.xrun = _ipc->posn_xrun;
+	_ipc->posn_notify = 0;
+	_ipc->posn_xrun = 0;
+	spin_unlock_irq(&_ipc->lock, flags);
+
+	posn.hdr.cmd = SOF_IPC_GLB_STREAM_MSG | SOF_IPC_STREAM_POSN_NOTIFY;
+	posn.hdr.size = sizeof(posn);
+
+	ipc_queue_host_message(_ipc, posn.hdr.cmd, &posn, sizeof(posn),
+		NULL, 0, NULL, NULL);
+}
+
+void ipc_buffer_xrun(void)
+{
+	_ipc->buffer_xrun = 1;
+}
+
+/* send status of each buffer with a new xrun, at most once per interval */
+static void ipc_buffer_xrun_notify(void)
+{
+	struct sof_ipc_buffer_status status;
+	struct ipc_buffer_dev *icb;
+	struct list_item *clist;
+	uint32_t current = platform_timer_get(NULL);
+	uint32_t interval = clock_us_to_ticks(PLATFORM_SCHED_CLOCK,
+		BUFFER_XRUN_NOTIFY_US);
+
+	_ipc->buffer_xrun = 0;
+
+	list_for_item(clist, &_ipc->buffer_list) {
+		icb = container_of(clist, struct ipc_buffer_dev, list);
+
+		if (!icb->cb->stats.xrun_pending)
+			continue;
+
+		/* too soon, xruns until then are sent in one status */
+		if (current - icb->cb->stats.last_notify < interval) {
+			_ipc->buffer_xrun = 1;
+			continue;
+		}
+
+		ipc_buffer_status_fill(icb->cb, &status);
+
+		/* try again next time if message queue is full */
+		if (ipc_queue_host_message(_ipc, status.hdr.cmd, &status,
+			sizeof(status), NULL, 0, NULL, NULL) < 0) {
+			_ipc->buffer_xrun = 1;
+			return;
+		}
+
+		icb->cb->stats.xrun_pending = 0;
+		icb->cb->stats.last_notify = current;
+	}
+}
+
 int ipc_queue_host_message(struct ipc *ipc, uint32_t header,
 	void *tx_data, size_t tx_bytes, void *rx_data,
 	size_t rx_bytes, void (*cb)(void*, void*), void *cb_data)
@@ -723,6 +1572,10 @@ int ipc_process_msg_queue(void)
 {
 	if (_ipc->host_pending)
 		ipc_platform_do_cmd(_ipc);
+	if (_ipc->posn_notify)
+		ipc_stream_posn_notify();
+	if (_ipc->buffer_xrun)
+		ipc_buffer_xrun_notify();
 	if (_ipc->dsp_pending)
 		ipc_platform_send_msg(_ipc);
 	return 0;
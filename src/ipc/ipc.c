@@ -43,13 +43,21 @@
 #include <reef/audio/pipeline.h>
 #include <reef/audio/buffer.h>
 
+/*
+ * Components, buffers and pipelines are hashed by ID so that IPC lookups
+ * don't need to walk every object in the topology. Topology IDs are normally
+ * allocated sequentially so the low bits of the ID are used as the hash.
+ * There is one bucket for each ID below PLATFORM_MAX_TPLG_IDS so lookups are
+ * O(1) for IDs in that range. The buckets are not resized, so IDs above it
+ * share buckets and a lookup scans one entry per PLATFORM_MAX_TPLG_IDS range
+ * that is in use.
+ */
+
 struct ipc_comp_dev *ipc_get_comp(struct ipc *ipc, uint32_t id)
 {
-	struct ipc_comp_dev *icd;
-	struct list_item *clist;
+	struct ipc_comp_dev *icd = ipc->comp_hash[ipc_id_hash(id)];
 
-	list_for_item(clist, &ipc->comp_list) {
-		icd = container_of(clist, struct ipc_comp_dev, list);
+	for (; icd != NULL; icd = icd->hash_next) {
 		if (icd->cd->comp.id == id)
 			return icd;
 	}
@@ -59,11 +67,9 @@ struct ipc_comp_dev *ipc_get_comp(struct ipc *ipc, uint32_t id)
 
 struct ipc_buffer_dev *ipc_get_buffer(struct ipc *ipc, uint32_t id)
 {
-	struct ipc_buffer_dev *icb;
-	struct list_item *clist;
+	struct ipc_buffer_dev *icb = ipc->buffer_hash[ipc_id_hash(id)];
 
-	list_for_item(clist, &ipc->buffer_list) {
-		icb = container_of(clist, struct ipc_buffer_dev, list);
+	for (; icb != NULL; icb = icb->hash_next) {
 		if (icb->cb->ipc_buffer.comp.id == id)
 			return icb;
 	}
@@ -73,11 +79,9 @@ struct ipc_buffer_dev *ipc_get_buffer(struct ipc *ipc, uint32_t id)
 
 struct ipc_pipeline_dev *ipc_get_pipeline(struct ipc *ipc, uint32_t id)
 {
-	struct ipc_pipeline_dev *ipd;
-	struct list_item *clist;
+	struct ipc_pipeline_dev *ipd = ipc->pipeline_hash[ipc_id_hash(id)];
 
-	list_for_item(clist, &ipc->pipeline_list) {
-		ipd = container_of(clist, struct ipc_pipeline_dev, list);
+	for (; ipd != NULL; ipd = ipd->hash_next) {
 		if (ipd->pipeline->id == id)
 			return ipd;
 	}
@@ -85,6 +89,37 @@ struct ipc_pipeline_dev *ipc_get_pipeline(struct ipc *ipc, uint32_t id)
 	return NULL;
 }
 
+static void ipc_comp_hash_del(struct ipc *ipc, struct ipc_comp_dev *icd)
+{
+	struct ipc_comp_dev **prev;
+
+	prev = &ipc->comp_hash[ipc_id_hash(icd->cd->comp.id)];
+	while (*prev != icd)
+		prev = &(*prev)->hash_next;
+	*prev = icd->hash_next;
+}
+
+static void ipc_buffer_hash_del(struct ipc *ipc, struct ipc_buffer_dev *ibd)
+{
+	struct ipc_buffer_dev **prev;
+
+	prev = &ipc->buffer_hash[ipc_id_hash(ibd->cb->ipc_buffer.comp.id)];
+	while (*prev != ibd)
+		prev = &(*prev)->hash_next;
+	*prev = ibd->hash_next;
+}
+
+static void ipc_pipeline_hash_del(struct ipc *ipc,
+	struct ipc_pipeline_dev *ipd)
+{
+	struct ipc_pipeline_dev **prev;
+
+	prev = &ipc->pipeline_hash[ipc_id_hash(ipd->pipeline->id)];
+	while (*prev != ipd)
+		prev = &(*prev)->hash_next;
+	*prev = ipd->hash_next;
+}
+
 int ipc_comp_new(struct ipc *ipc, struct sof_ipc_comp *comp)
 {
 	struct comp_dev *cd;
@@ -115,8 +150,10 @@ int ipc_comp_new(struct ipc *ipc, struct sof_ipc_comp *comp)
 	}
 	icd->cd = cd;
 
-	/* add new component to the list */
+	/* add new component to the list and hash */
 	list_item_append(&icd->list, &ipc->comp_list);
+	icd->hash_next = ipc->comp_hash[ipc_id_hash(comp->id)];
+	ipc->comp_hash[ipc_id_hash(comp->id)] = icd;
 	return ret;
 }
 
@@ -129,9 +166,10 @@ void ipc_comp_free(struct ipc *ipc, uint32_t comp_id)
 	if (icd == NULL)
 		return;
 
-	/* free component and remove from list */
-	comp_free(icd->cd);
+	/* remove from hash and list then free component */
+	ipc_comp_hash_del(ipc, icd);
 	list_item_del(&icd->list);
+	comp_free(icd->cd);
 	rfree(icd);
 }
 
@@ -163,8 +201,10 @@ int ipc_buffer_new(struct ipc *ipc, struct sof_ipc_buffer *desc)
 	}
 	ibd->cb = buffer;
 
-	/* add new buffer to the list */
+	/* add new buffer to the list and hash */
 	list_item_append(&ibd->list, &ipc->buffer_list);
+	ibd->hash_next = ipc->buffer_hash[ipc_id_hash(desc->comp.id)];
+	ipc->buffer_hash[ipc_id_hash(desc->comp.id)] = ibd;
 	return ret;
 }
 
@@ -177,9 +217,10 @@ void ipc_buffer_free(struct ipc *ipc, uint32_t buffer_id)
 	if (ibd == NULL)
 		return;
 
-	/* free buffer and remove from list */
-	buffer_free(ibd->cb);
+	/* remove from hash and list then free buffer */
+	ipc_buffer_hash_del(ipc, ibd);
 	list_item_del(&ibd->list);
+	buffer_free(ibd->cb);
 	rfree(ibd);
 }
 
@@ -283,6 +324,7 @@ int ipc_pipeline_new(struct ipc *ipc,
 {
 	struct ipc_pipeline_dev *ipc_pipe;
 	struct pipeline *pipe;
+	int ret;
 
 	/* check whether the pipeline already exists */
 	ipc_pipe = ipc_get_pipeline(ipc, pipe_desc->pipeline_id);
@@ -296,18 +338,30 @@ int ipc_pipeline_new(struct ipc *ipc,
 		return -ENOMEM;
 	}
 
+	/* reject pipeline if DSP could never meet its deadline */
+	ret = schedule_task_config(&pipe->pipe_task, pipe->deadline,
+		pipe_desc->mips);
+	if (ret < 0) {
+		trace_ipc_error("ePa");
+		pipeline_free(pipe);
+		return ret;
+	}
+
 	/* allocate the IPC pipeline container */
 	ipc_pipe = rzalloc(RZONE_RUNTIME, RFLAGS_NONE,
 		sizeof(struct ipc_pipeline_dev));
 	if (ipc_pipe == NULL) {
-		rfree(pipe);
+		pipeline_free(pipe);
 		return -ENOMEM;
 	}
 
 	ipc_pipe->pipeline = pipe;
 
-	/* add new pipeline to the list */
+	/* add new pipeline to the list and hash */
 	list_item_append(&ipc_pipe->list, &ipc->pipeline_list);
+	ipc_pipe->hash_next =
+		ipc->pipeline_hash[ipc_id_hash(pipe_desc->pipeline_id)];
+	ipc->pipeline_hash[ipc_id_hash(pipe_desc->pipeline_id)] = ipc_pipe;
 	return 0;
 }
 
@@ -320,12 +374,28 @@ void ipc_pipeline_free(struct ipc *ipc, uint32_t pipeline_id)
 	if (ipc_pipe == NULL)
 		return;
 
-	/* free buffer and remove from list */
-	pipeline_free(ipc_pipe->pipeline);
+	/* remove from hash and list then free pipeline */
+	ipc_pipeline_hash_del(ipc, ipc_pipe);
 	list_item_del(&ipc_pipe->list);
+	pipeline_free(ipc_pipe->pipeline);
 	rfree(ipc_pipe);
 }
 
+int ipc_pipeline_complete(struct ipc *ipc, uint32_t pipeline_id)
+{
+	struct ipc_pipeline_dev *ipc_pipe;
+
+	/* check whether pipeline exists */
+	ipc_pipe = ipc_get_pipeline(ipc, pipeline_id);
+	if (ipc_pipe == NULL) {
+		trace_ipc_error("ePc");
+		return -EINVAL;
+	}
+
+	/* plan pipeline buffer memory */
+	return pipeline_complete(ipc_pipe->pipeline);
+}
+
 int ipc_init(struct reef *reef)
 {
 	trace_ipc("IPI");
@@ -35,6 +35,7 @@
 #include <reef/trace.h>
 #include <reef/lock.h>
 #include <platform/memory.h>
+#include <arch/cache.h>
 #include <stdint.h>
 
 /* debug to set memory value on every allocation */
@@ -281,7 +282,7 @@ static void *alloc_cont_blocks(struct mm_heap *heap, int level, int bflags,
 			hdr = &map->block[current];
 
 			/* is block used */
-			if (hdr->flags == RFLAGS_USED)
+			if (hdr->flags & RFLAGS_USED)
 				break;
 		}
 
@@ -509,96 +510,453 @@ void rbfree(void *ptr)
 	spin_unlock_irq(&memmap.lock, flags);
 }
 
-uint32_t mm_pm_context_size(void)
-{
+/*
+ * PM context. The host buffer mirrors the heaps so every block has a fixed
+ * host offset and is only copied if it is used and its block group changed
+ * since the last save to the same buffer. Allocations made during boot are
+ * rebuilt by the next boot so they are not saved. The allocator state and
+ * the system heap allocated after boot are small and copied every time. The
+ * header is cleared first and only written by mm_pm_context_commit() once
+ * the caller has saved all of its own context, so a partial save is never
+ * restored.
+ *
+ * +--------------------------------------------------------------------------+
+ * | Offset              | Context        |  Size                             |
+ * +---------------------+----------------+-----------------------------------+
+ * | 0                   | Header         |  sizeof(struct mm_pm_hdr)         |
+ * | MM_PM_STATE_OFFSET  | Maps and Heads |  mm_pm_state_size()               |
+ * | mm_pm_heap_offset() | System Heap    |  HEAP_SYSTEM_SIZE                 |
+ * |                     | Runtime Heap   |  HEAP_RUNTIME_SIZE                |
+ * |                     | Module Buffers |  HEAP_BUFFER_SIZE                 |
+ * +---------------------+----------------+-----------------------------------+
+ */
+
+#define MM_PM_MAGIC		0x4d504d52	/* "RMPM" */
+#define MM_PM_GROUP_SIZE	1024	/* bytes per dirty checksum */
+#define MM_PM_STATE_OFFSET	sizeof(struct mm_pm_hdr)
+
+/* block groups of runtime and buffer heaps */
+#define MM_PM_GROUPS \
+	((HEAP_RUNTIME_SIZE + HEAP_BUFFER_SIZE) / MM_PM_GROUP_SIZE + \
+	ARRAY_SIZE(rt_heap_map) + ARRAY_SIZE(buf_heap_map))
+
+struct mm_pm_hdr {
+	uint32_t magic;
+	uint32_t size;		/* context size */
+	uint32_t sys_start;	/* system heap allocated after boot */
+	uint32_t sys_end;
+};
+
+/* allocator state in context order */
+static const struct {
+	void *ptr;
 	uint32_t size;
+} mm_pm_state[] = {
+	{&memmap, sizeof(memmap)},
+	{rt_heap_map, sizeof(rt_heap_map)},
+	{mod_block16, sizeof(mod_block16)},
+	{mod_block32, sizeof(mod_block32)},
+	{mod_block64, sizeof(mod_block64)},
+	{mod_block128, sizeof(mod_block128)},
+	{mod_block256, sizeof(mod_block256)},
+	{mod_block512, sizeof(mod_block512)},
+	{mod_block1024, sizeof(mod_block1024)},
+	{buf_heap_map, sizeof(buf_heap_map)},
+	{buf_block, sizeof(buf_block)},
+};
+
+/* boot state - rebuilt on every boot */
+static uint32_t mm_pm_boot_heap;	/* system heap at end of boot */
+
+/* host copy state - checksum of each block group, 0 if not saved */
+static uint32_t mm_pm_host;	/* host buffer the sums are for */
+static uint32_t mm_pm_sum[MM_PM_GROUPS];
+
+static uint32_t mm_pm_state_size(void)
+{
+	uint32_t size = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mm_pm_state); i++)
+		size += mm_pm_state[i].size;
 
-	/* calc context size for each area  */
-	size = memmap.buffer.info.used;
-	size += memmap.runtime.info.used;
-	size += memmap.system.info.used;
+	/* all state is word sized so host offsets stay aligned for DMA */
+	return size;
+}
+
+/* host offset of heap memory */
+static inline uint32_t mm_pm_heap_offset(uint32_t addr)
+{
+	return MM_PM_STATE_OFFSET + mm_pm_state_size() + addr -
+		HEAP_SYSTEM_BASE;
+}
+
+/* blocks per dirty checksum */
+static inline uint32_t mm_pm_group_blocks(struct block_map *map)
+{
+	return (MM_PM_GROUP_SIZE + map->block_size - 1) / map->block_size;
+}
+
+/* is block part of context - used and not rebuilt by boot */
+static inline int mm_pm_block_saved(struct block_hdr *hdr)
+{
+	return hdr->flags && !(hdr->flags & RFLAGS_BOOT);
+}
+
+/* checksum of saved blocks in group, never 0 */
+static uint32_t mm_pm_group_sum(struct block_map *map, uint32_t first,
+	uint32_t last)
+{
+	uint32_t *word, sum = 0x811c9dc5;
+	uint32_t block, i;
+
+	for (block = first; block < last; block++) {
+		if (!mm_pm_block_saved(&map->block[block]))
+			continue;
+
+		/* block index so allocating or freeing changes the sum */
+		sum = (sum ^ block) * 0x01000193;
+
+		word = (uint32_t *)(map->base + block * map->block_size);
+		for (i = 0; i < map->block_size >> 2; i++)
+			sum = (sum ^ word[i]) * 0x01000193;
+	}
 
-	/* add memory maps */
-	size += heap_get_size(&memmap.buffer);
-	size += heap_get_size(&memmap.runtime);
-	size += heap_get_size(&memmap.system);
+	return sum ? sum : 1;
+}
+
+static int mm_pm_copy_to_host(struct dma_sg_config *sg, uint32_t offset,
+	void *ptr, uint32_t size)
+{
+	int ret;
+
+	dcache_writeback_region(ptr, size);
+	ret = dma_copy_to_host(sg, offset, ptr, size);
+
+	return ret < 0 ? ret : 0;
+}
+
+static int mm_pm_copy_from_host(struct dma_sg_config *sg, uint32_t offset,
+	void *ptr, uint32_t size)
+{
+	int ret;
+
+	ret = dma_copy_from_host(sg, offset, ptr, size);
+	dcache_invalidate_region(ptr, size);
+
+	return ret < 0 ? ret : 0;
+}
+
+/* copy runs of saved blocks in group to or from host */
+static int mm_pm_group_copy(struct dma_sg_config *sg, struct block_map *map,
+	uint32_t first, uint32_t last, int save)
+{
+	uint32_t block, start, addr, size;
+	int ret;
+
+	for (block = first; block < last; block++) {
+		if (!mm_pm_block_saved(&map->block[block]))
+			continue;
+
+		/* merge with following saved blocks */
+		start = block;
+		while (block + 1 < last &&
+			mm_pm_block_saved(&map->block[block + 1]))
+			block++;
+
+		addr = map->base + start * map->block_size;
+		size = (block + 1 - start) * map->block_size;
+
+		if (save)
+			ret = mm_pm_copy_to_host(sg, mm_pm_heap_offset(addr),
+				(void *)addr, size);
+		else
+			ret = mm_pm_copy_from_host(sg, mm_pm_heap_offset(addr),
+				(void *)addr, size);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* save changed block groups of heap, or restore all saved blocks */
+static int mm_pm_heap_copy(struct dma_sg_config *sg, struct mm_heap *heap,
+	uint32_t *group, int save)
+{
+	struct block_map *map;
+	uint32_t first, last, sum;
+	int i, ret;
+
+	for (i = 0; i < heap->blocks; i++) {
+		map = &heap->map[i];
+
+		for (first = 0; first < map->count; first = last, (*group)++) {
+			last = first + mm_pm_group_blocks(map);
+			if (last > map->count)
+				last = map->count;
+
+			sum = mm_pm_group_sum(map, first, last);
+
+			/* host copy of group is already up to date */
+			if (save && sum == mm_pm_sum[*group])
+				continue;
+
+			ret = mm_pm_group_copy(sg, map, first, last, save);
+			if (ret < 0)
+				return ret;
+
+			/* restored groups match the host copy */
+			if (!save)
+				sum = mm_pm_group_sum(map, first, last);
+			mm_pm_sum[*group] = sum;
+		}
+	}
+
+	return 0;
+}
 
+/* system heap allocated after boot, word aligned for DMA */
+static inline uint32_t mm_pm_sys_start(void)
+{
+	return mm_pm_boot_heap & ~(sizeof(uint32_t) - 1);
+}
+
+static inline uint32_t mm_pm_sys_end(void)
+{
+	return (memmap.system.heap + sizeof(uint32_t) - 1) &
+		~(sizeof(uint32_t) - 1);
+}
+
+/* heaps have only boot allocations */
+static int mm_pm_boot_state(void)
+{
+	struct block_map *map;
+	int i, j;
+
+	if (memmap.system.heap != mm_pm_boot_heap)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(rt_heap_map); i++) {
+		map = &rt_heap_map[i];
+		for (j = 0; j < map->count; j++) {
+			if (mm_pm_block_saved(&map->block[j]))
+				return 0;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(buf_heap_map); i++) {
+		map = &buf_heap_map[i];
+		for (j = 0; j < map->count; j++) {
+			if (mm_pm_block_saved(&map->block[j]))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* mark boot allocations, these are not saved in the PM context */
+void mm_pm_boot_complete(void)
+{
+	struct block_map *map;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(rt_heap_map); i++) {
+		map = &rt_heap_map[i];
+		for (j = 0; j < map->count; j++) {
+			if (map->block[j].flags)
+				map->block[j].flags |= RFLAGS_BOOT;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(buf_heap_map); i++) {
+		map = &buf_heap_map[i];
+		for (j = 0; j < map->count; j++) {
+			if (map->block[j].flags)
+				map->block[j].flags |= RFLAGS_BOOT;
+		}
+	}
+
+	mm_pm_boot_heap = memmap.system.heap;
+}
+
+uint32_t mm_pm_context_size(void)
+{
 	/* recalc totals */
 	memmap.total.free = memmap.buffer.info.free +
 		memmap.runtime.info.free + memmap.system.info.free;
 	memmap.total.used = memmap.buffer.info.used +
 		memmap.runtime.info.used + memmap.system.info.used;
 
-	return size;
+	/* heaps are mirrored so blocks have a fixed host offset */
+	return mm_pm_heap_offset(HEAP_SYSTEM_BASE) + HEAP_SYSTEM_SIZE +
+		memmap.runtime.size + memmap.buffer.size;
 }
 
 /*
  * Save the DSP memories that are in use the system and modules. All pipeline and modules
  * must be disabled before calling this functions. No allocations are permitted after
- * calling this and before calling restore.
+ * calling this and before calling restore. Components must have released their
+ * DMA channels and PM copies use the channel boot descriptor so no DMA copy
+ * here allocates from the heaps being saved.
  */
 int mm_pm_context_save(struct dma_sg_config *sg)
 {
-	uint32_t used;
-	int32_t offset = 0, ret;
+	struct dma_sg_elem *elem;
+	struct mm_pm_hdr hdr;
+	uint32_t offset, group = 0;
+	int i, ret;
 
 	/* first make sure SG buffer has enough space on host for DSP context */
-	used = mm_pm_context_size();
-	if (used > dma_sg_get_size(sg))
+	if (mm_pm_context_size() > dma_sg_get_size(sg))
 		return -EINVAL;
 
-	/* copy memory maps to SG */
-	ret = dma_copy_to_host(sg, offset,
-		(void *)&memmap, sizeof(memmap));
+	/* checksums only describe the buffer they were saved to */
+	elem = list_first_item(&sg->elem_list, struct dma_sg_elem, list);
+	if (elem->dest != mm_pm_host) {
+		bzero(mm_pm_sum, sizeof(mm_pm_sum));
+		mm_pm_host = elem->dest;
+	}
+
+	/* invalidate any previous context until this one is committed */
+	bzero(&hdr, sizeof(hdr));
+	ret = mm_pm_copy_to_host(sg, 0, &hdr, sizeof(hdr));
 	if (ret < 0)
-		return ret;
+		goto err;
+
+	/* copy memory maps to SG before anything else can touch them */
+	offset = MM_PM_STATE_OFFSET;
+	for (i = 0; i < ARRAY_SIZE(mm_pm_state); i++) {
+		ret = mm_pm_copy_to_host(sg, offset, mm_pm_state[i].ptr,
+			mm_pm_state[i].size);
+		if (ret < 0)
+			goto err;
+		offset += mm_pm_state[i].size;
+	}
 
-	/* copy system memory contents to SG */
-	ret = dma_copy_to_host(sg, offset + ret,
-		(void *)memmap.system.heap, (int32_t)(memmap.system.size));
+	/* copy changed module and buffer memory contents to SG */
+	ret = mm_pm_heap_copy(sg, &memmap.runtime, &group, 1);
 	if (ret < 0)
-		return ret;
+		goto err;
 
-	/* copy module memory contents to SG */
-	// TODO: iterate over module block map and copy contents of each block
-	// to the host.
+	ret = mm_pm_heap_copy(sg, &memmap.buffer, &group, 1);
+	if (ret < 0)
+		goto err;
+
+	/* copy system memory allocated after boot to SG */
+	if (mm_pm_sys_end() > mm_pm_sys_start()) {
+		ret = mm_pm_copy_to_host(sg,
+			mm_pm_heap_offset(mm_pm_sys_start()),
+			(void *)mm_pm_sys_start(),
+			mm_pm_sys_end() - mm_pm_sys_start());
+		if (ret < 0)
+			goto err;
+	}
 
-	/* copy buffer memory contents to SG */
-	// TODO: iterate over buffer block map and copy contents of each block
-	// to the host.
+	return 0;
 
+err:
+	/* host copy is unknown so save everything next time */
+	trace_mem_error("ePs");
+	mm_pm_host = 0;
 	return ret;
 }
 
+/*
+ * Validate the saved context. Called after mm_pm_context_save() and after any
+ * other context the caller stores in the same buffer has been saved.
+ */
+int mm_pm_context_commit(struct dma_sg_config *sg)
+{
+	struct mm_pm_hdr hdr;
+	int ret;
+
+	hdr.magic = MM_PM_MAGIC;
+	hdr.size = mm_pm_context_size();
+	hdr.sys_start = mm_pm_sys_start();
+	hdr.sys_end = mm_pm_sys_end();
+	ret = mm_pm_copy_to_host(sg, 0, &hdr, sizeof(hdr));
+	if (ret < 0) {
+		trace_mem_error("ePc");
+		mm_pm_host = 0;
+		return ret;
+	}
+
+	return 0;
+}
+
 /*
  * Restore the DSP memories to modules abd the system. This must be called immediately
  * after booting before any pipeline work.
  */
 int mm_pm_context_restore(struct dma_sg_config *sg)
 {
-	int32_t offset = 0, ret;
+	struct dma_sg_elem *elem;
+	struct mm_pm_hdr hdr;
+	uint32_t offset, group = 0;
+	int i, ret;
 
-	/* copy memory maps from SG */
-	ret = dma_copy_from_host(sg, offset,
-		(void *)&memmap, sizeof(memmap));
-	if (ret < 0)
-		return ret;
+	if (mm_pm_context_size() > dma_sg_get_size(sg))
+		return -EINVAL;
 
-	/* copy system memory contents from SG */
-	ret = dma_copy_to_host(sg, offset + ret,
-		(void *)memmap.system.heap, (int32_t)(memmap.system.size));
+	/* nothing but boot may have allocated memory */
+	if (!mm_pm_boot_state()) {
+		trace_mem_error("ePb");
+		return -EBUSY;
+	}
+
+	/* context must be complete and from this firmware boot layout */
+	ret = mm_pm_copy_from_host(sg, 0, &hdr, sizeof(hdr));
 	if (ret < 0)
 		return ret;
 
-	/* copy module memory contents from SG */
-	// TODO: iterate over module block map and copy contents of each block
-	// to the host. This is the same block order used by the context store
+	if (hdr.magic != MM_PM_MAGIC || hdr.size != mm_pm_context_size() ||
+		hdr.sys_start != mm_pm_sys_start() ||
+		hdr.sys_end < hdr.sys_start ||
+		hdr.sys_end > HEAP_SYSTEM_BASE + HEAP_SYSTEM_SIZE) {
+		trace_mem_error("ePh");
+		return -EINVAL;
+	}
 
-	/* copy buffer memory contents from SG */
-	// TODO: iterate over buffer block map and copy contents of each block
-	// to the host. This is the same block order used by the context store
+	/* copy memory maps from SG */
+	offset = MM_PM_STATE_OFFSET;
+	for (i = 0; i < ARRAY_SIZE(mm_pm_state); i++) {
+		ret = mm_pm_copy_from_host(sg, offset, mm_pm_state[i].ptr,
+			mm_pm_state[i].size);
+		if (ret < 0)
+			goto err;
+		offset += mm_pm_state[i].size;
+	}
+
+	/* copy system memory allocated after boot from SG */
+	if (hdr.sys_end > hdr.sys_start) {
+		ret = mm_pm_copy_from_host(sg,
+			mm_pm_heap_offset(hdr.sys_start),
+			(void *)hdr.sys_start, hdr.sys_end - hdr.sys_start);
+		if (ret < 0)
+			goto err;
+	}
+
+	/* copy module and buffer memory contents from SG */
+	elem = list_first_item(&sg->elem_list, struct dma_sg_elem, list);
+	mm_pm_host = elem->dest;
+
+	ret = mm_pm_heap_copy(sg, &memmap.runtime, &group, 0);
+	if (ret < 0)
+		goto err;
+
+	ret = mm_pm_heap_copy(sg, &memmap.buffer, &group, 0);
+	if (ret < 0)
+		goto err;
 
 	return 0;
+
+err:
+	/* maps may be restored without their memory so we cant continue */
+	trace_mem_error("ePr");
+	panic(PANIC_MEM);
+	return ret;
 }
 
 /* initialise map */
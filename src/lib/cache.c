@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Intel Corporation nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: agent <agent@local>
+ */
+
+#include <reef/cache.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* run batch operation on one region */
+static void dcache_region_op(uint32_t op, struct dcache_region *region)
+{
+	void *addr = (void *)region->start;
+	size_t size = region->end - region->start;
+
+	switch (op) {
+	case DCACHE_WRITEBACK:
+		dcache_writeback_region(addr, size);
+		break;
+	case DCACHE_INVALIDATE:
+		dcache_invalidate_region(addr, size);
+		break;
+	case DCACHE_WRITEBACK_INVALIDATE:
+	default:
+		dcache_writeback_invalidate_region(addr, size);
+		break;
+	}
+}
+
+void dcache_batch_add(struct dcache_batch *batch, void *ptr, size_t size)
+{
+	struct dcache_region *region;
+	uint32_t start, end;
+	uint32_t i;
+
+	/* uncached memory needs no maintenance */
+	if (size == 0 || !dcache_is_cached(ptr))
+		return;
+
+	start = (uint32_t)ptr & ~(DCACHE_LINE_SIZE - 1);
+	end = ((uint32_t)ptr + size + DCACHE_LINE_SIZE - 1) &
+		~(DCACHE_LINE_SIZE - 1);
+
+	/* absorb overlapping or adjacent regions until none are left */
+	i = 0;
+	while (i < batch->count) {
+		region = &batch->region[i];
+
+		if (start > region->end || end < region->start) {
+			i++;
+			continue;
+		}
+
+		if (region->start < start)
+			start = region->start;
+		if (region->end > end)
+			end = region->end;
+
+		/* replace with last region and check it again */
+		*region = batch->region[--batch->count];
+	}
+
+	/* no room for another region so flush what we have */
+	if (batch->count == DCACHE_BATCH_REGIONS)
+		dcache_batch_flush(batch);
+
+	region = &batch->region[batch->count++];
+	region->start = start;
+	region->end = end;
+}
+
+void dcache_batch_add_ring(struct dcache_batch *batch, void *ptr, size_t size,
+	void *addr, void *end)
+{
+	size_t head = (char *)end - (char *)ptr;
+
+	if (size <= head) {
+		dcache_batch_add(batch, ptr, size);
+		return;
+	}
+
+	/* region wraps to the start of the ring */
+	dcache_batch_add(batch, ptr, head);
+	dcache_batch_add(batch, addr, size - head);
+}
+
+void dcache_batch_flush(struct dcache_batch *batch)
+{
+	uint32_t i;
+
+	for (i = 0; i < batch->count; i++)
+		dcache_region_op(batch->op, &batch->region[i]);
+
+	batch->count = 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2026, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Intel Corporation nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#include <reef/dma-trace.h>
+#include <reef/trace.h>
+#include <reef/alloc.h>
+#include <reef/interrupt.h>
+#include <reef/mailbox.h>
+#include <reef/reef.h>
+#include <arch/cache.h>
+#include <platform/dma.h>
+#include <platform/platform.h>
+#include <uapi/ipc.h>
+#include <stdint.h>
+#include <errno.h>
+
+/*
+ * DMA trace.
+ *
+ * Trace events are written to a ring buffer in DRAM and full blocks of the
+ * ring are copied by DMA to a host buffer in the background. Producers only
+ * need to mask IRQs on their own core for a few instructions whilst an event
+ * is written and the cache is written back once per block before it is
+ * copied. Events are dropped and counted if the ring is full. The drain work
+ * is only scheduled once a block is full, so idle tracing has no wakeups.
+ */
+
+static struct dma_trace_data *dmat;
+
+/* DMA copy of block to host has completed */
+static void trace_dma_cb(void *data, uint32_t type, struct dma_sg_elem *next)
+{
+	struct dma_trace_data *d = (struct dma_trace_data *)data;
+	volatile struct sof_ipc_dma_trace_posn *posn =
+		(struct sof_ipc_dma_trace_posn *)mailbox_get_trace_base();
+
+	if (type != DMA_IRQ_TYPE_LLIST)
+		return;
+
+	/* block can now be reused by producers */
+	d->ring.r_pos += DMA_TRACE_BLOCK_SIZE;
+	d->host_offset += DMA_TRACE_BLOCK_SIZE;
+	if (d->host_offset >= d->host_size)
+		d->host_offset = 0;
+	d->copy_pending = 0;
+
+	/* let host know trace position and any dropped events */
+	posn->hdr.cmd = SOF_IPC_GLB_TRACE_MSG | SOF_IPC_TRACE_DMA_POSITION;
+	posn->hdr.size = sizeof(*posn);
+	posn->host_offset = d->host_offset;
+	posn->overflow = d->ring.dropped;
+	posn->messages = d->ring.messages;
+	dcache_writeback_region((void *)posn, sizeof(*posn));
+
+	/* one block per copy */
+	next->size = DMA_RELOAD_END;
+}
+
+/* get host SG elem for host offset */
+static struct dma_sg_elem *trace_host_elem(struct dma_trace_data *d)
+{
+	struct dma_sg_elem *elem;
+	struct list_item *plist;
+	uint32_t offset = d->host_offset;
+
+	list_for_item(plist, &d->host_sg.elem_list) {
+		elem = container_of(plist, struct dma_sg_elem, list);
+		if (offset < elem->size)
+			return elem;
+		offset -= elem->size;
+	}
+
+	return NULL;
+}
+
+/* copy next full block of ring to host */
+static uint32_t trace_work(void *data, uint32_t delay)
+{
+	struct dma_trace_data *d = (struct dma_trace_data *)data;
+	struct dma_trace_ring *ring = &d->ring;
+	struct dma_sg_elem *host_elem;
+	uint32_t offset;
+
+	/* wait for current block copy to complete */
+	if (d->copy_pending)
+		return DMA_TRACE_US;
+
+	/* only full blocks are copied, producers reschedule when one fills */
+	if (ring->w_pos - ring->r_pos < DMA_TRACE_BLOCK_SIZE)
+		return 0;
+
+	host_elem = trace_host_elem(d);
+	if (host_elem == NULL) {
+		trace_error(TRACE_CLASS_DMA, "eTh");
+		return 0;
+	}
+
+	/* writeback the whole block before DMA reads it */
+	offset = ring->r_pos & (DMA_TRACE_RING_SIZE - 1);
+	dcache_writeback_region((char *)ring->addr + offset,
+		DMA_TRACE_BLOCK_SIZE);
+
+	/* host elems are host pages and blocks never span pages */
+	d->elem.src = (uint32_t)ring->addr + offset;
+	d->elem.dest = host_elem->dest + d->host_offset % HOST_PAGE_SIZE;
+	d->elem.size = DMA_TRACE_BLOCK_SIZE;
+
+	d->copy_pending = 1;
+	dma_set_config(d->dma, d->chan, &d->config);
+	dma_start(d->dma, d->chan);
+
+	return DMA_TRACE_US;
+}
+
+/* write record to ring - returns 1 if record will be copied to host */
+int dma_trace_event(uint32_t *words, uint32_t count)
+{
+	struct dma_trace_ring *ring;
+	uint32_t bytes = count * sizeof(uint32_t);
+	uint32_t flags, i, full;
+
+	if (dmat == NULL)
+		return 0;
+
+	ring = &dmat->ring;
+
+	/* only IRQs on this core can write to this ring */
+	flags = interrupt_global_disable();
+
+	/* is there space for the whole record ? */
+	if (ring->w_pos - ring->r_pos > DMA_TRACE_RING_SIZE - bytes) {
+		ring->dropped++;
+		goto out;
+	}
+
+	/* records can wrap at the end of the ring */
+	for (i = 0; i < count; i++) {
+		ring->addr[(ring->w_pos >> 2) & (DMA_TRACE_RING_WORDS - 1)] =
+			words[i];
+		ring->w_pos += sizeof(uint32_t);
+	}
+	ring->messages++;
+
+out:
+	full = ring->w_pos - ring->r_pos >= DMA_TRACE_BLOCK_SIZE;
+	interrupt_global_enable(flags);
+
+	/* drain is idle until a block is full, no-op if already scheduled */
+	if (full && dmat->enabled)
+		work_schedule_default(&dmat->dmat_work, DMA_TRACE_US);
+
+	return dmat->enabled;
+}
+
+/* start copying trace to host buffer */
+int dma_trace_enable(struct dma_sg_config *host_sg, uint32_t host_size)
+{
+	struct dma_trace_data *d = dmat;
+	struct list_item *plist, *tlist;
+
+	if (d == NULL)
+		return -ENODEV;
+
+	/* host buffer must hold whole blocks */
+	if (host_size < DMA_TRACE_BLOCK_SIZE ||
+		host_size % DMA_TRACE_BLOCK_SIZE) {
+		trace_error(TRACE_CLASS_DMA, "eTs");
+		return -EINVAL;
+	}
+
+	/* only one host buffer */
+	if (d->enabled)
+		return -EBUSY;
+
+	d->dma = dma_get(DMA_ID_DMAC0);
+	if (d->dma == NULL)
+		return -ENODEV;
+
+	d->chan = dma_channel_get(d->dma);
+	if (d->chan < 0) {
+		trace_error(TRACE_CLASS_DMA, "eTc");
+		return d->chan;
+	}
+
+	/* set up DMA configuration */
+	d->config.direction = DMA_DIR_LMEM_TO_HMEM;
+	d->config.src_width = sizeof(uint32_t);
+	d->config.dest_width = sizeof(uint32_t);
+	d->config.cyclic = 0;
+	list_init(&d->config.elem_list);
+	list_item_prepend(&d->elem.list, &d->config.elem_list);
+	dma_set_cb(d->dma, d->chan, DMA_IRQ_TYPE_LLIST, trace_dma_cb, d);
+
+	/* move host elems to trace SG list as caller's list is temporary */
+	list_init(&d->host_sg.elem_list);
+	list_for_item_safe(plist, tlist, &host_sg->elem_list) {
+		list_item_del(plist);
+		list_item_append(plist, &d->host_sg.elem_list);
+	}
+
+	d->host_size = host_size;
+	d->host_offset = 0;
+	d->enabled = 1;
+
+	work_schedule_default(&d->dmat_work, DMA_TRACE_US);
+	return 0;
+}
+
+int dma_trace_init(void)
+{
+	struct dma_trace_data *d;
+
+	d = rzalloc(RZONE_SYS, RFLAGS_NONE, sizeof(*d));
+	if (d == NULL)
+		return -ENOMEM;
+
+	d->ring.addr = rballoc(RZONE_RUNTIME, RFLAGS_NONE,
+		DMA_TRACE_RING_SIZE);
+	if (d->ring.addr == NULL) {
+		rfree(d);
+		return -ENOMEM;
+	}
+
+	work_init(&d->dmat_work, trace_work, d, WORK_ASYNC);
+
+	/* events are written to ring from now on */
+	dmat = d;
+	return 0;
+}
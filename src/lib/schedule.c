@@ -45,9 +45,15 @@
 #include <reef/audio/pipeline.h>
 #include <arch/task.h>
 
+/* max_rtime decays towards recent run times by 1/16 per run */
+#define SCHEDULE_RTIME_DECAY	4
+
 struct schedule_data {
 	spinlock_t lock;
 	struct list_item list;	/* list of tasks in priority queue */
+	struct task *level_task[TASK_LEVELS];	/* task dispatched at level */
+	struct list_item admit_list;	/* list of admitted tasks */
+	uint32_t util_max;	/* max utilisation in 1/1000 */
 	uint32_t clock;
 };
 
@@ -68,64 +74,72 @@ static inline uint32_t schedule_time_diff(uint32_t current, uint32_t pipe_time)
 }
 
 /*
- * Find the task with the earliest deadline. This may be the running task or a
- * queued task. TODO: Reduce cache invalidations by checking if the currently
- * running task AND the earliest queued task will both complete before their
- * deadlines. If so, then schedule the earlier queued task after the currently
- * running task has completed.
+ * Find the queued task with the earliest deadline at each priority level.
+ * Levels that already have a task dispatched are skipped as the dispatched
+ * task must complete before the next task at that level can run.
  */
-static struct task *edf_get_next(void)
+static void edf_get_next(struct task *next[TASK_LEVELS])
 {
-	struct task *task, *next_task = NULL;
+	struct task *task;
 	struct list_item *clist;
-	uint32_t next_delta = MAX_INT, current, delta;
- 
+	uint32_t next_delta[TASK_LEVELS], current, delta;
+	int level;
+
+	for (level = 0; level < TASK_LEVELS; level++) {
+		next[level] = NULL;
+		next_delta[level] = MAX_INT;
+	}
+
 	/* get the current time */
 	current = platform_timer_get(NULL);
 
-	/* check every queued or running task in list */
+	/* check every queued task in list */
 	list_for_item(clist, &sch->list) {
 		task = container_of(clist, struct task, list);
 
+		if (task->state != TASK_STATE_QUEUED)
+			continue;
+
+		level = task_get_level(task);
+		if (sch->level_task[level] != NULL)
+			continue;
+
 		/* get earliest deadline */
 		delta = schedule_time_diff(current, task->deadline);
-		if (delta < next_delta) {
-			next_delta = delta;
-			next_task = task;
+		if (delta < next_delta[level]) {
+			next_delta[level] = delta;
+			next[level] = task;
 		}
 	}
-
-	return next_task;
 }
 
 /*
  * EDF Scheduler - Earliest Deadline First Scheduler.
  *
- * Schedule task with the earliest deadline from task list.
+ * Dispatch the task with the earliest deadline at each priority level.
  * Can run in IRQ context.
  */
 void schedule_edf(void)
 {
-	struct task *task;
+	struct task *next[TASK_LEVELS];
 	uint32_t flags;
+	int level;
 
 	tracev_pipe("EDF");
 
-	/* get next component scheduled  */
 	spin_lock_irq(&sch->lock, flags);
 
-	/* get next task to be scheduled */
-	task = edf_get_next();
-	if (task == NULL)
-		goto out;
+	/* get next task to be scheduled at each level */
+	edf_get_next(next);
 
-	/* is task currently running ? */
-	if (task->state == TASK_STATE_RUNNING)
-		goto out;
+	for (level = 0; level < TASK_LEVELS; level++) {
+		if (next[level] == NULL)
+			continue;
 
-	arch_run_task(task);
+		sch->level_task[level] = next[level];
+		arch_run_task(next[level]);
+	}
 
-out:
 	spin_unlock_irq(&sch->lock, flags);
 
 	interrupt_clear(PLATFORM_SCHEDULE_IRQ);
@@ -140,8 +154,15 @@ int schedule_task_del(struct task *task)
 	/* add task to list */
 	spin_lock_irq(&sch->lock, flags);
 
-	/* is task already running ? */
-	if (task->state == TASK_STATE_RUNNING) {
+	/* is task already running or preempted ? */
+	if (task->state == TASK_STATE_RUNNING ||
+		task->state == TASK_STATE_PREEMPTED) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	/* task may be dispatched but not yet started */
+	if (sch->level_task[task_get_level(task)] == task) {
 		ret = -EAGAIN;
 		goto out;
 	}
@@ -154,11 +175,12 @@ out:
 	return ret;
 }
 
-/* Add a new task to the scheduler to be run */
-void schedule_task(struct task *task, uint32_t deadline, uint16_t priority,
+/* Add a new task to the scheduler to be run unless it's already pending */
+int schedule_task(struct task *task, uint32_t deadline, int16_t priority,
 		void *data)
 {
 	uint32_t flags, time, current, ticks;
+	int ret = 0;
 
 	/* get the current time */
 	current = platform_timer_get(NULL);
@@ -169,23 +191,220 @@ void schedule_task(struct task *task, uint32_t deadline, uint16_t priority,
 
 	/* add task to list */
 	spin_lock_irq(&sch->lock, flags);
+
+	/* task is already in list, it can be queued again once complete */
+	if (task->state == TASK_STATE_QUEUED ||
+		task->state == TASK_STATE_RUNNING ||
+		task->state == TASK_STATE_PREEMPTED) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	task->release = current;
 	task->deadline = time;
 	task->priority = priority;
 	task->sdata = data;
 	list_item_prepend(&task->list, &sch->list);
 	task->state = TASK_STATE_QUEUED;
+
+out:
+	spin_unlock_irq(&sch->lock, flags);
+	return ret;
+}
+
+/* Task is about to run - called by arch at task level */
+void schedule_task_running(struct task *task)
+{
+	struct task *lower;
+	uint32_t flags;
+	int level;
+
+	spin_lock_irq(&sch->lock, flags);
+
+	/* has a running task at a lower level been preempted ? */
+	for (level = task_get_level(task) - 1; level >= 0; level--) {
+		lower = sch->level_task[level];
+		if (lower == NULL)
+			continue;
+
+		if (lower->state == TASK_STATE_RUNNING) {
+			lower->state = TASK_STATE_PREEMPTED;
+			lower->preemptions++;
+		}
+
+		/* tasks below are already preempted or not started */
+		break;
+	}
+
+	task->state = TASK_STATE_RUNNING;
 	spin_unlock_irq(&sch->lock, flags);
 }
 
 /* Remove a task from the scheduler when complete */
 void schedule_task_complete(struct task *task)
 {
-	uint32_t flags;
+	struct task *lower;
+	uint32_t flags, current, response;
+	int level;
+
+	current = platform_timer_get(NULL);
 
 	spin_lock_irq(&sch->lock, flags);
+
+	/* response time statistics */
+	response = current - task->release;
+	if (response > task->max_response)
+		task->max_response = response;
+	if ((int32_t)(current - task->deadline) > 0) {
+		task->deadline_misses++;
+		trace_error1(TRACE_CLASS_PIPE, "eSd", response);
+	}
+
 	list_item_del(&task->list);
 	task->state = TASK_STATE_COMPLETED;
+	sch->level_task[task_get_level(task)] = NULL;
+
+	/* resume the preempted task at the next lower level */
+	for (level = task_get_level(task) - 1; level >= 0; level--) {
+		lower = sch->level_task[level];
+		if (lower == NULL)
+			continue;
+
+		if (lower->state == TASK_STATE_PREEMPTED)
+			lower->state = TASK_STATE_RUNNING;
+		break;
+	}
+
 	spin_unlock_irq(&sch->lock, flags);
+
+	/* run any tasks queued whilst this level was busy */
+	if (!list_is_empty(&sch->list))
+		schedule();
+}
+
+/*
+ * Admission Control.
+ *
+ * Each task has a period and a run time per period. The run time is the
+ * larger of the declared budget and the measured worst case run time so
+ * tasks that take longer than declared are accounted for once they have run.
+ * EDF can meet all deadlines whilst the sum of run time / period is below 1,
+ * so tasks are rejected if the sum would exceed the platform bound. Tasks are
+ * only admitted whilst they are started so idle tasks don't use any time.
+ */
+
+/* utilisation of task in 1/1000 */
+static uint32_t task_utilisation(struct task *task)
+{
+	uint32_t rtime;
+
+	rtime = task->max_rtime / clock_us_to_ticks(sch->clock, 1);
+	if (rtime < task->budget)
+		rtime = task->budget;
+
+	return rtime * 1000 / task->period;
+}
+
+/* utilisation of all admitted tasks in 1/1000 - locks held by caller */
+static uint32_t _schedule_utilisation(void)
+{
+	struct task *task;
+	struct list_item *clist;
+	uint32_t util = 0;
+
+	list_for_item(clist, &sch->admit_list) {
+		task = container_of(clist, struct task, admit_list);
+		util += task_utilisation(task);
+	}
+
+	return util;
+}
+
+uint32_t schedule_utilisation(void)
+{
+	uint32_t flags, util;
+
+	spin_lock_irq(&sch->lock, flags);
+	util = _schedule_utilisation();
+	spin_unlock_irq(&sch->lock, flags);
+
+	return util;
+}
+
+uint32_t schedule_utilisation_max(void)
+{
+	return sch->util_max;
+}
+
+/* set task period in us and worst case instructions per period */
+int schedule_task_config(struct task *task, uint32_t period, uint32_t mips)
+{
+	if (period == 0)
+		return -EINVAL;
+
+	task->period = period;
+	task->budget = mips / (clock_get_freq(CLK_CPU) / 1000000);
+
+	/* task can never be admitted */
+	if (task_utilisation(task) > sch->util_max) {
+		trace_error1(TRACE_CLASS_PIPE, "eSa", task_utilisation(task));
+		task->period = 0;
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+/* admit task when it's started - measured run times are used if known */
+int schedule_task_admit(struct task *task)
+{
+	uint32_t flags, util;
+	int ret = 0;
+
+	if (task->period == 0)
+		return -EINVAL;
+
+	spin_lock_irq(&sch->lock, flags);
+
+	/* already admitted, e.g. released from pause */
+	if (!list_is_empty(&task->admit_list))
+		goto out;
+
+	util = _schedule_utilisation() + task_utilisation(task);
+	if (util > sch->util_max) {
+		trace_error1(TRACE_CLASS_PIPE, "eSc", util);
+		ret = -EBUSY;
+		goto out;
+	}
+
+	list_item_append(&task->admit_list, &sch->admit_list);
+
+out:
+	spin_unlock_irq(&sch->lock, flags);
+	return ret;
+}
+
+/* release task time when it's stopped */
+void schedule_task_release(struct task *task)
+{
+	uint32_t flags;
+
+	spin_lock_irq(&sch->lock, flags);
+	if (!list_is_empty(&task->admit_list)) {
+		list_item_del(&task->admit_list);
+		list_init(&task->admit_list);
+	}
+	spin_unlock_irq(&sch->lock, flags);
+}
+
+/* record task run time - keeps a rolling worst case */
+void schedule_task_rtime(struct task *task, uint32_t ticks)
+{
+	if (ticks > task->max_rtime)
+		task->max_rtime = ticks;
+	else
+		task->max_rtime -=
+			(task->max_rtime - ticks) >> SCHEDULE_RTIME_DECAY;
 }
 
 void scheduler_run(void *unused)
@@ -208,8 +427,10 @@ int scheduler_init(struct reef *reef)
 
 	sch = rzalloc(RZONE_SYS, RFLAGS_NONE, sizeof(*sch));
 	list_init(&sch->list);
+	list_init(&sch->admit_list);
 	spinlock_init(&sch->lock);
 	sch->clock = PLATFORM_SCHED_CLOCK;
+	sch->util_max = PLATFORM_SCHEDULE_UTIL_MAX;
 
 	/* configure scheduler interrupt */
 	interrupt_register(PLATFORM_SCHEDULE_IRQ, scheduler_run, NULL);
@@ -29,31 +29,89 @@
  */
 
 #include <reef/trace.h>
-#include <arch/cache.h>
+#include <reef/dma-trace.h>
+#include <reef/cache.h>
 #include <stdint.h>
+#include <errno.h>
 
 /* trace position */
 static uint32_t trace_pos = 0;
 static uint32_t trace_enable = 1;
 
-void _trace_event(uint32_t event)
+/* runtime class filter - class bitmap for each level */
+uint32_t trace_mask[TRACE_LEVELS] = {
+	TRACE_CLASS_ALL,	/* TRACE_LEVEL_ERROR */
+	TRACE_CLASS_ALL,	/* TRACE_LEVEL_INFO */
+	0,			/* TRACE_LEVEL_VERBOSE */
+};
+
+/* last event was traced so values that follow it are traced too */
+uint32_t trace_values = 1;
+
+/* write record of timestamp, event and args */
+static void trace_write(uint32_t event, uint32_t *args, uint32_t nargs)
 {
-	volatile uint32_t *t =
-		(volatile uint32_t*)(MAILBOX_TRACE_BASE + trace_pos);
+	volatile uint32_t *t;
+	struct dcache_batch batch;
+	uint32_t words[2 + TRACE_ARGS_MAX];
+	uint32_t i;
 
 	if (!trace_enable)
 		return;
 
-	/* write timestamp and event to trace buffer */
-	t[0] = platform_timer_get(0);
-	t[1] = event;
+	words[0] = platform_timer_get(0);
+	words[1] = event;
+	for (i = 0; i < nargs; i++)
+		words[2 + i] = args[i];
+
+	/* trace goes to host by DMA once host has provided a buffer */
+	if (dma_trace_event(words, nargs + 2))
+		return;
+
+	/* write record to mailbox trace buffer */
+	dcache_batch_init(&batch, DCACHE_WRITEBACK);
+	for (i = 0; i < nargs + 2; i++) {
+		t = (volatile uint32_t*)(MAILBOX_TRACE_BASE + trace_pos);
+		*t = words[i];
+		dcache_batch_add(&batch, (void *)t, sizeof(uint32_t));
+
+		trace_pos += sizeof(uint32_t);
+		if (trace_pos >= MAILBOX_TRACE_SIZE)
+			trace_pos = 0;
+	}
+
+	/* writeback trace record */
+	dcache_batch_flush(&batch);
+}
+
+void _trace_event(uint32_t event)
+{
+	trace_values = 1;
+	trace_write(event, NULL, 0);
+}
+
+/* values are args so decoders don't parse them as events */
+void _trace_value(uint32_t value)
+{
+	trace_write(TRACE_VALUE_EVENT, &value, 1);
+}
 
-	/* writeback trace data */
-	dcache_writeback_region((void*)t, sizeof(uint32_t) * 2);
+void _trace_event_args(uint32_t event, uint32_t nargs, uint32_t a0,
+	uint32_t a1, uint32_t a2, uint32_t a3)
+{
+	uint32_t args[TRACE_ARGS_MAX] = {a0, a1, a2, a3};
+
+	trace_values = 1;
+	trace_write(event | (nargs << TRACE_ARGS_SHIFT), args, nargs);
+}
+
+int trace_set_filter(uint32_t level, uint32_t mask)
+{
+	if (level >= TRACE_LEVELS)
+		return -EINVAL;
 
-	trace_pos += (sizeof(uint32_t) << 1);
-	if (trace_pos >= MAILBOX_TRACE_SIZE)
-		trace_pos = 0;
+	trace_mask[level] = mask;
+	return 0;
 }
 
 void trace_off(void)
@@ -56,12 +56,35 @@
  * The generic work queues are intended to stay in time synchronisation with
  * any CPU clock changes. i.e. timeouts will remain constant regardless of CPU
  * frequency changes.
+ *
+ * Pending work is stored in a hierarchical timer wheel so that scheduling and
+ * cancelling work is O(1) and finding the next timeout only needs to check one
+ * bitmap per wheel level. Each level has WORK_WHEEL_SLOTS slots and every
+ * level is WORK_WHEEL_LVL_SHIFT bits coarser than the level below it. Work is
+ * placed in the finest level that can hold its timeout, so work never runs
+ * early but can run up to one slot late for that level.
  */
 
+/* timer wheel geometry */
+#define WORK_WHEEL_LEVELS	4
+#define WORK_WHEEL_SLOTS	32	/* must match bits in slot bitmap */
+#define WORK_WHEEL_SLOT_MASK	(WORK_WHEEL_SLOTS - 1)
+#define WORK_WHEEL_SHIFT	8	/* level 0 slot is 256 ticks */
+#define WORK_WHEEL_LVL_SHIFT	3	/* each level is 8x coarser */
+
+#define work_wheel_shift(level) \
+	(WORK_WHEEL_SHIFT + (level) * WORK_WHEEL_LVL_SHIFT)
+
+struct work_wheel_level {
+	uint32_t bitmap;	/* slots that may contain work */
+	struct list_item slot[WORK_WHEEL_SLOTS];
+};
+
 struct work_queue {
-	struct list_item work;		/* list of work */
+	struct work_wheel_level level[WORK_WHEEL_LEVELS];	/* pending work */
+	uint32_t count;			/* work items in wheel */
+	uint32_t wheel_ticks;		/* ticks when wheel was last advanced */
 	uint32_t timeout;		/* timeout for next queue run */
-	uint32_t window_size;		/* window size for pending work */
 	spinlock_t lock;
 	struct notifier notifier;	/* notify CPU freq changes */
 	struct work_queue_timesource *ts;	/* time source for work queue */
@@ -89,53 +112,150 @@ static inline uint32_t work_get_timer(struct work_queue *queue)
 	return queue->ts->timer_get(&queue->ts->timer);
 }
 
-/* is there any work pending in the current time window ? */
-static int is_work_pending(struct work_queue *queue)
+/* has work timed out - timeouts and current time can both overflow */
+static inline int work_is_due(struct work *work, uint32_t current)
 {
-	struct list_item *wlist;
-	struct work *work;
-	uint32_t win_end, win_start;
-	int pending_count = 0;
+	return (int32_t)(current - work->timeout) >= 0;
+}
 
-	/* get the current valid window of work */
-	win_end = work_get_timer(queue);
-	win_start = win_end - queue->window_size;
+/* rotate slot bitmap so that bit 0 is the slot after slot "start" */
+static inline uint32_t wheel_bitmap_from(uint32_t bitmap, uint32_t start)
+{
+	start = (start + 1) & WORK_WHEEL_SLOT_MASK;
 
-	/* correct the pending flag window for overflow */
-	if (win_end > win_start) {
+	if (start == 0)
+		return bitmap;
 
-		/* mark each valid work item in this time period as pending */
-		list_for_item(wlist, &queue->work) {
+	return (bitmap >> start) | (bitmap << (WORK_WHEEL_SLOTS - start));
+}
 
-			work = container_of(wlist, struct work, list);
+/* insert work into wheel slot for its timeout - locks held by caller */
+static void wheel_insert(struct work_queue *queue, struct work *work)
+{
+	struct work_wheel_level *level;
+	uint32_t shift, base, slot, timeout, distance = 0;
+	int i;
+
+	/* late work goes in the next level 0 slot */
+	timeout = work->timeout;
+	if ((int32_t)(timeout - queue->wheel_ticks) < 0)
+		timeout = queue->wheel_ticks;
+
+	/* find finest level that covers the timeout, clamp to last level */
+	for (i = 0; i < WORK_WHEEL_LEVELS; i++) {
+		shift = work_wheel_shift(i);
+
+		/* distance in slots from last wheel slot at this level */
+		base = queue->wheel_ticks & ~((1 << shift) - 1);
+		distance = ((timeout - base) >> shift) + 1;
+		if (distance <= WORK_WHEEL_SLOTS)
+			break;
+	}
 
-			/* if work has timed out then mark it as pending to run */
-			if (work->timeout >= win_start && work->timeout <= win_end) {
-				work->pending = 1;
-				pending_count++;
-			} else {
-				work->pending = 0;
-			}
-		}
-	} else {
+	/* work beyond wheel range is re-inserted when the last slot expires */
+	if (i == WORK_WHEEL_LEVELS) {
+		i = WORK_WHEEL_LEVELS - 1;
+		shift = work_wheel_shift(i);
+		distance = WORK_WHEEL_SLOTS;
+	}
+
+	level = &queue->level[i];
+	slot = ((queue->wheel_ticks >> shift) + distance) &
+		WORK_WHEEL_SLOT_MASK;
+
+	list_item_append(&work->list, &level->slot[slot]);
+	level->bitmap |= 1 << slot;
+	queue->count++;
+}
+
+/* remove work from the wheel or expired list - locks held by caller */
+static inline void wheel_remove(struct work_queue *queue, struct work *work)
+{
+	/* slot bitmap is cleared lazily when the slot is next checked */
+	list_item_del(&work->list);
+	list_init(&work->list);
+	queue->count--;
+}
+
+/*
+ * Move all work from every slot that has expired since the wheel was last
+ * advanced onto the expired list and advance the wheel to current. Work on
+ * the expired list is still counted as queued until it's removed to run.
+ */
+static void wheel_advance(struct work_queue *queue, uint32_t current,
+	struct list_item *expired)
+{
+	struct work_wheel_level *level;
+	struct list_item *slot_list;
+	struct work *work;
+	uint32_t shift, base, slots, mask, bitmap;
+	int i, slot;
+
+	for (i = 0; i < WORK_WHEEL_LEVELS; i++) {
+		level = &queue->level[i];
+		shift = work_wheel_shift(i);
+
+		/* number of slots that expired at this level */
+		base = queue->wheel_ticks & ~((1 << shift) - 1);
+		slots = (current - base) >> shift;
+		if (slots == 0)
+			continue;
+
+		/* mask of expired slots, starting from slot after base */
+		if (slots >= WORK_WHEEL_SLOTS)
+			mask = MAX_INT;
+		else
+			mask = (1 << slots) - 1;
 
-		/* mark each valid work item in this time period as pending */
-		list_for_item(wlist, &queue->work) {
+		slot = ((base >> shift) + 1) & WORK_WHEEL_SLOT_MASK;
+		if (slot)
+			mask = (mask << slot) | (mask >> (WORK_WHEEL_SLOTS - slot));
 
-			work = container_of(wlist, struct work, list);
+		bitmap = level->bitmap & mask;
+		level->bitmap &= ~mask;
 
-			/* if work has timed out then mark it as pending to run */
-			if (work->timeout <= win_end ||
-				(work->timeout >= win_start && work->timeout < MAX_INT)) {
-				work->pending = 1;
-				pending_count++;
-			} else {
-				work->pending = 0;
+		/* move work from each expired slot */
+		while (bitmap) {
+			slot = __builtin_ctz(bitmap);
+			bitmap &= ~(1 << slot);
+			slot_list = &level->slot[slot];
+
+			while (!list_is_empty(slot_list)) {
+				work = list_first_item(slot_list, struct work,
+					list);
+				list_item_del(&work->list);
+				list_item_append(&work->list, expired);
 			}
 		}
 	}
 
-	return pending_count;
+	queue->wheel_ticks = current;
+}
+
+/*
+ * Bring the wheel up to the current time before inserting new work so that
+ * the slot distance is measured from now. Expired work is put back into the
+ * next level 0 slot - locks held by caller.
+ */
+static void wheel_sync(struct work_queue *queue, uint32_t current)
+{
+	struct list_item expired;
+	struct work *work;
+
+	/* wheel is idle, so start it from now */
+	if (queue->count == 0) {
+		queue->wheel_ticks = current;
+		return;
+	}
+
+	list_init(&expired);
+	wheel_advance(queue, current, &expired);
+
+	while (!list_is_empty(&expired)) {
+		work = list_first_item(&expired, struct work, list);
+		wheel_remove(queue, work);
+		wheel_insert(queue, work);
+	}
 }
 
 static inline void work_next_timeout(struct work_queue *queue,
@@ -151,102 +271,156 @@ static inline void work_next_timeout(struct work_queue *queue,
 	}
 }
 
-/* run all pending work */
-static void run_work(struct work_queue *queue, uint32_t *flags)
+/* run all expired work - returns number of work items run */
+static int run_work(struct work_queue *queue, uint32_t *flags)
 {
-	struct list_item *wlist, *tlist;
+	struct list_item expired;
 	struct work *work;
-	uint32_t reschedule_usecs, udelay;
+	uint32_t reschedule_usecs, udelay, current;
+	int count = 0;
 
-	/* check each work item in queue for pending */
-	list_for_item_safe(wlist, tlist, &queue->work) {
+	list_init(&expired);
 
-		work = container_of(wlist, struct work, list);
+	current = work_get_timer(queue);
+	wheel_advance(queue, current, &expired);
 
-		/* run work if its pending and remove from the queue */
-		if (work->pending) {
+	/* work is removed from the head as callbacks can cancel other work */
+	while (!list_is_empty(&expired)) {
 
-			udelay = (work_get_timer(queue) - work->timeout) /
-				queue->ticks_per_usec;
+		work = list_first_item(&expired, struct work, list);
+		wheel_remove(queue, work);
 
-			/* work can run in non atomic context */
-			spin_unlock_irq(&queue->lock, *flags);
-			reschedule_usecs = work->cb(work->cb_data, udelay);
-			spin_lock_irq(&queue->lock, *flags);
+		/* work was beyond wheel range so is not due yet */
+		if (!work_is_due(work, current)) {
+			wheel_insert(queue, work);
+			continue;
+		}
 
-			/* do we need reschedule this work ? */
-			if (reschedule_usecs == 0)
-				list_item_del(&work->list);
-			else {
-				/* get next work timeout */
-				work_next_timeout(queue, work, reschedule_usecs);
-			}
+		udelay = (work_get_timer(queue) - work->timeout) /
+			queue->ticks_per_usec;
+
+		/* work can run in non atomic context */
+		spin_unlock_irq(&queue->lock, *flags);
+		reschedule_usecs = work->cb(work->cb_data, udelay);
+		spin_lock_irq(&queue->lock, *flags);
+		count++;
+
+		/* was work cancelled or rescheduled whilst running ? */
+		if (!work->pending || !list_is_empty(&work->list))
+			continue;
+
+		/* do we need reschedule this work ? */
+		if (reschedule_usecs == 0)
+			work->pending = 0;
+		else {
+			/* get next work timeout */
+			work_next_timeout(queue, work, reschedule_usecs);
+			wheel_insert(queue, work);
 		}
 	}
-}
 
-static inline uint32_t calc_delta_ticks(uint32_t current, uint32_t work)
-{
-	uint32_t max = MAX_INT;
-
-	/* does work run in next cycle ? */
-	if (work < current) {
-		max -= current;
-		max += work;
-		return max;
-	} else
-		return work - current;
+	return count;
 }
 
 /* calculate next timeout */
 static void queue_get_next_timeout(struct work_queue *queue)
 {
-	struct list_item *wlist;
-	struct work *work;
-	uint32_t delta = MAX_INT, current, d, ticks;
+	struct work_wheel_level *level;
+	uint32_t delta = MAX_INT, d, ticks = 0, shift, slot, next, current;
+	int i, found = 0;
 
 	/* only recalc if work list not empty */
-	if (list_is_empty(&queue->work)) {
+	if (queue->count == 0) {
 		queue->timeout = 0;
 		return;
 	}
 
-	ticks = current = work_get_timer(queue);
+	/* find the first non empty slot after the current slot at each level */
+	for (i = 0; i < WORK_WHEEL_LEVELS; i++) {
+		level = &queue->level[i];
+		shift = work_wheel_shift(i);
+		slot = queue->wheel_ticks >> shift;
 
-	/* find time for next work */
-	list_for_item(wlist, &queue->work) {
+		while (level->bitmap) {
+			next = slot + 1 +
+				__builtin_ctz(wheel_bitmap_from(level->bitmap, slot));
 
-		work = container_of(wlist, struct work, list);
-
-		d = calc_delta_ticks(current, work->timeout);
+			/* clear bitmap for slots emptied by cancel */
+			if (list_is_empty(&level->slot[next & WORK_WHEEL_SLOT_MASK])) {
+				level->bitmap &= ~(1 << (next & WORK_WHEEL_SLOT_MASK));
+				continue;
+			}
 
-		/* is work next ? */
-		if (d < delta) {
-			ticks = work->timeout;
-			delta = d;
+			/* slot expires at the start of the next slot */
+			d = (next << shift) - queue->wheel_ticks;
+			if (d < delta) {
+				ticks = next << shift;
+				delta = d;
+				found = 1;
+			}
+			break;
 		}
 	}
 
-	queue->timeout = ticks;
+	/* remaining work is on the expired list and queue run will re-arm */
+	if (!found) {
+		queue->timeout = 0;
+		return;
+	}
+
+	/* wheel may be behind current time, so don't set timer in the past */
+	current = work_get_timer(queue);
+	if ((int32_t)(ticks - current) <= 0)
+		ticks = current + queue->ticks_per_usec;
+
+	/* timer value of 0 means no timeout */
+	queue->timeout = ticks ? ticks : 1;
 }
 
 /* re calculate timers for queue after CPU frequency change */
 static void queue_recalc_timers(struct work_queue *queue,
 	struct clock_notify_data *clk_data)
 {
-	struct list_item *wlist;
+	struct list_item pending;
+	struct work_wheel_level *level;
 	struct work *work;
 	uint32_t delta_ticks, delta_usecs, current;
+	int i, j;
+
+	list_init(&pending);
 
 	/* get current time */
 	current = work_get_timer(queue);
 
-	/* re calculate timers for each work item */
-	list_for_item(wlist, &queue->work) {
+	/* take all work out of the wheel */
+	for (i = 0; i < WORK_WHEEL_LEVELS; i++) {
+		level = &queue->level[i];
+
+		for (j = 0; j < WORK_WHEEL_SLOTS; j++) {
+			while (!list_is_empty(&level->slot[j])) {
+				work = list_first_item(&level->slot[j],
+					struct work, list);
+				list_item_del(&work->list);
+				list_item_append(&work->list, &pending);
+				queue->count--;
+			}
+		}
+
+		level->bitmap = 0;
+	}
+
+	/* wheel is empty apart from any expired work */
+	queue->wheel_ticks = current;
 
-		work = container_of(wlist, struct work, list);
+	/* re calculate timers for each work item and re-insert */
+	while (!list_is_empty(&pending)) {
+		work = list_first_item(&pending, struct work, list);
+		list_item_del(&work->list);
 
-		delta_ticks = calc_delta_ticks(current, work->timeout);
+		if (work_is_due(work, current))
+			delta_ticks = 0;
+		else
+			delta_ticks = work->timeout - current;
 		delta_usecs = delta_ticks / clk_data->old_ticks_per_usec;
 
 		/* is work within next msec, then schedule it now */
@@ -254,6 +428,8 @@ static void queue_recalc_timers(struct work_queue *queue,
 			work->timeout = current + queue->ticks_per_usec * delta_usecs;
 		else
 			work->timeout = current + (queue->ticks_per_usec >> 3);
+
+		wheel_insert(queue, work);
 	}
 }
 
@@ -281,8 +457,8 @@ static void queue_run(void *data)
 	/* work can take variable time to complete so we re-check the
 	  queue after running all the pending work to make sure no new work
 	  is pending */
-	while (is_work_pending(queue))
-		run_work(queue, &flags);
+	while (run_work(queue, &flags))
+		;
 
 	/* re-calc timer and re-arm */
 	queue_reschedule(queue);
@@ -304,10 +480,7 @@ static void work_notify(int message, void *data, void *event_data)
 	if (message == CLOCK_NOTIFY_POST) {
 
 		/* CPU frequency update complete */
-		/* scale the window size to clock speed */
 		queue->ticks_per_usec = clock_us_to_ticks(queue->ts->clk, 1);
-		queue->window_size =
-			queue->ticks_per_usec * PLATFORM_WORKQ_WINDOW;
 		queue_recalc_timers(queue, clk_data);
 		queue_reschedule(queue);
 	} else if (message == CLOCK_NOTIFY_PRE) {
@@ -319,26 +492,25 @@ static void work_notify(int message, void *data, void *event_data)
 
 void work_schedule(struct work_queue *queue, struct work *w, uint32_t timeout)
 {
-	struct work *work;
-	struct list_item *wlist;
-	uint32_t flags;
+	uint32_t flags, current;
 
 	spin_lock_irq(&queue->lock, flags);
 
-	/* check to see if we are already scheduled ? */
-	list_for_item(wlist, &queue->work) {
-		work = container_of(wlist, struct work, list);
+	/* check to see if we are already scheduled ? keep original timeout */
+	if (w->pending)
+		goto out;
 
-		/* keep original timeout */
-		if (work == w)
-			goto out;
-	}
+	current = work_get_timer(queue);
+
+	/* measure the timeout from now and not the last wheel advance */
+	wheel_sync(queue, current);
 
 	/* convert timeout micro seconds to CPU clock ticks */
-	w->timeout = queue->ticks_per_usec * timeout + work_get_timer(queue);
+	w->timeout = queue->ticks_per_usec * timeout + current;
+	w->pending = 1;
 
-	/* insert work into list */
-	list_item_prepend(&w->list, &queue->work);
+	/* insert work into wheel */
+	wheel_insert(queue, w);
 
 	/* re-calc timer and re-arm */
 	queue_reschedule(queue);
@@ -353,72 +525,51 @@ void work_cancel(struct work_queue *queue, struct work *w)
 
 	spin_lock_irq(&queue->lock, flags);
 
-	/* remove work from list */
-	list_item_del(&w->list);
+	/* is work scheduled ? */
+	if (!w->pending)
+		goto out;
+
+	w->pending = 0;
+
+	/* running work is not in the wheel or on the expired list */
+	if (list_is_empty(&w->list))
+		goto out;
+
+	wheel_remove(queue, w);
 
 	/* re-calc timer and re-arm */
 	queue_reschedule(queue);
 
+out:
 	spin_unlock_irq(&queue->lock, flags);
 }
 
 void work_schedule_default(struct work *w, uint32_t timeout)
 {
-	struct work *work;
-	struct list_item *wlist;
-	uint32_t flags;
-
-	spin_lock_irq(&queue_->lock, flags);
-
-	/* check to see if we are already scheduled ? */
-	list_for_item(wlist, &queue_->work) {
-		work = container_of(wlist, struct work, list);
-
-		/* keep original timeout */
-		if (work == w)
-			goto out;
-	}
-
-	/* convert timeout microsecs to CPU clock ticks */
-	w->timeout = queue_->ticks_per_usec * timeout + work_get_timer(queue_);
-
-	/* insert work into list */
-	list_item_prepend(&w->list, &queue_->work);
-
-	/* re-calc timer and re-arm */
-	queue_reschedule(queue_);
-
-out:
-	spin_unlock_irq(&queue_->lock, flags);
+	work_schedule(queue_, w, timeout);
 }
 
 void work_cancel_default(struct work *w)
 {
-	uint32_t flags;
-
-	spin_lock_irq(&queue_->lock, flags);
-
-	/* remove work from list */
-	list_item_del(&w->list);
-
-	/* re-calc timer and re-arm */
-	queue_reschedule(queue_);
-
-	spin_unlock_irq(&queue_->lock, flags);
+	work_cancel(queue_, w);
 }
 
 struct work_queue *work_new_queue(struct work_queue_timesource *ts)
 {
 	struct work_queue *queue;
+	int i, j;
 
 	/* init work queue */
-	queue = rmalloc(RZONE_SYS, RFLAGS_NONE, sizeof(*queue_));
+	queue = rzalloc(RZONE_SYS, RFLAGS_NONE, sizeof(*queue_));
+
+	for (i = 0; i < WORK_WHEEL_LEVELS; i++) {
+		for (j = 0; j < WORK_WHEEL_SLOTS; j++)
+			list_init(&queue->level[i].slot[j]);
+	}
 
-	list_init(&queue->work);
 	spinlock_init(&queue->lock);
 	queue->ts = ts;
 	queue->ticks_per_usec = clock_us_to_ticks(queue->ts->clk, 1);
-	queue->window_size = queue->ticks_per_usec * PLATFORM_WORKQ_WINDOW;
 
 	/* notification of clk changes */
 	queue->notifier.cb = work_notify;
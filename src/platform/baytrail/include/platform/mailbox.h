@@ -69,4 +69,10 @@
 #define MAILBOX_TRACE_BASE \
 	(MAILBOX_BASE + MAILBOX_TRACE_OFFSET)
 
+#define MAILBOX_CONTROL_OFFSET \
+	(MAILBOX_TRACE_SIZE + MAILBOX_TRACE_OFFSET)
+#define MAILBOX_CONTROL_SIZE	0x80
+#define MAILBOX_CONTROL_BASE \
+	(MAILBOX_BASE + MAILBOX_CONTROL_OFFSET)
+
 #endif
@@ -111,6 +111,10 @@
 /* Heap configuration */
 #define REEF_DATA_SIZE			0x6800
 
+/* hot code and data are linked first in IRAM and DRAM0, see __hot_text */
+#define REEF_HOT_TEXT_SIZE		0x2000
+#define REEF_HOT_DATA_SIZE		0x1000
+
 #define HEAP_SYSTEM_BASE		(DRAM0_BASE + REEF_DATA_SIZE)
 #define HEAP_SYSTEM_SIZE		0x2000
 
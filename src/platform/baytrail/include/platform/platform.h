@@ -60,6 +60,9 @@ struct reef;
 
 #define PLATFORM_SCHEDULE_COST	200
 
+/* max EDF utilisation of admitted tasks in 1/1000 */
+#define PLATFORM_SCHEDULE_UTIL_MAX	900
+
 /* DMA treats PHY addresses as host address unless within DSP region */
 #define PLATFORM_HOST_DMA_MASK	0xFF000000
 
@@ -77,6 +80,7 @@ struct reef;
 /* Platform Host DMA buffer config - these should align with DMA engine */
 #define PLAT_HOST_PERIOD_FRAMES	48	/* must be multiple of DMA burst size */
 #define PLAT_HOST_PERIODS	2	/* give enough latency for DMA refill */
+#define PLAT_HOST_DEEP_PERIODS	8	/* min periods per deep refill */
 
 /* Platform Dev DMA buffer config - these should align with DMA engine */
 #define PLAT_DAI_PERIOD_FRAMES	48	/* must be multiple of DMA+DEV burst size */
@@ -92,15 +96,15 @@ struct reef;
 #define PLATFORM_NUM_MMAP_POSN	10
 #define PLATFORM_NUM_MMAP_VOL	10
 
+/* topology component, buffer and pipeline IDs are expected below this */
+#define PLATFORM_MAX_TPLG_IDS	64	/* must be power of 2 */
+
 /* DMA channel drain timeout in microseconds */
 #define PLATFORM_DMA_TIMEOUT	1333
 
 /* IPC page data copy timeout */
 #define PLATFORM_IPC_DMA_TIMEOUT 2000
 
-/* WorkQ window size in microseconds */
-#define PLATFORM_WORKQ_WINDOW	2000
-
 /* Host finish work schedule delay in microseconds */
 #define PLATFORM_HOST_FINISH_DELAY	100
 
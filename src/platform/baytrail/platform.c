@@ -45,6 +45,7 @@
 #include <reef/clock.h>
 #include <reef/ipc.h>
 #include <reef/trace.h>
+#include <reef/dma-trace.h>
 #include <reef/audio/component.h>
 #include <config.h>
 #include <string.h>
@@ -155,6 +156,7 @@ int platform_init(struct reef *reef)
 
 	/* clear mailbox for early trace and debug */
 	bzero((void*)MAILBOX_BASE, IPC_MAX_MAILBOX_BYTES);
+	bzero((void*)MAILBOX_CONTROL_BASE, MAILBOX_CONTROL_SIZE);
 
 	trace_point(TRACE_BOOT_PLATFORM_SHIM);
 
@@ -212,6 +214,9 @@ int platform_init(struct reef *reef)
 	dma_probe(dmac2);
 #endif
 
+	/* init DMA trace ring, events go to host once host provides buffer */
+	dma_trace_init();
+
 	/* mask SSP interrupts */
 	shim_write(SHIM_PIMR, shim_read(SHIM_PIMR) | 0x00000038);
 
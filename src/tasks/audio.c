@@ -67,6 +67,7 @@ int do_task(struct reef *reef)
         sys_comp_tone_init();
         sys_comp_eq_iir_init();
         sys_comp_eq_fir_init();
+	sys_comp_convert_init();
 
 #if STATIC_PIPE
 	/* init static pipeline */
@@ -82,6 +83,7 @@ int do_task(struct reef *reef)
 
 		/* sleep until next IPC or DMA */
 		wait_for_interrupt(0);
+		ipc_pm_wakeup();
 
 		/* now process any IPC messages from host */
 		ipc_process_msg_queue();